@@ -0,0 +1,654 @@
+#include "ns3/command-line.h"
+#include "ns3/uinteger.h"
+#include "ns3/double.h"
+#include "ns3/string.h"
+#include "ns3/log.h"
+#include "ns3/abort.h"
+#include "ns3/rng-seed-manager.h"
+#include "ns3/random-variable-stream.h"
+#include "ns3/yans-wifi-helper.h"
+#include "ns3/yans-wifi-channel.h"
+#include "ns3/wifi-net-device.h"
+#include "ns3/wifi-phy.h"
+#include "ns3/wifi-remote-station-manager.h"
+#include "ns3/he-configuration.h"
+#include "ns3/mobility-helper.h"
+#include "ns3/internet-stack-helper.h"
+#include "ns3/ipv4-address-helper.h"
+#include "ns3/packet-sink-helper.h"
+#include "ns3/on-off-helper.h"
+#include "ns3/propagation-loss-model.h"
+#include "ns3/propagation-delay-model.h"
+#include "ns3/MonteCarloSimulator.h"
+#include "ns3/MonteCarloSimulatorT.h"
+#include "ns3/MonteCarloProfiler.h"
+#include "ns3/MonteCarloJobQueue.h"
+#include "algorithm"
+#include "chrono"
+#include "cmath"
+#include "iostream"
+#include "map"
+#include "sstream"
+#include "csignal"
+#include "sys/resource.h"
+#include "sys/wait.h"
+#include "unistd.h"
+#ifdef __linux__
+#include "sys/prctl.h"
+#endif
+
+using namespace ns3;
+
+NS_LOG_COMPONENT_DEFINE ("MonteCarloSimulatorEnterprise");
+
+/*
+ * Parameterized enterprise WLAN scenario: nAps access points and nStas stations, each station
+ * having one Wi-Fi interface per candidate AP (the "candidates" nearest APs). Every
+ * (station, candidate AP) pair is a flow with its own OnOff source and PacketSink; a station
+ * is associated with exactly one candidate at a time by bringing up the matching IPv4
+ * interface, as in the toy scenario. All per-device attributes are set through object pointers.
+ */
+struct ScenarioConfig
+{
+    uint32_t nAps = 16;
+    uint32_t nStas = 100;
+    uint32_t candidates = 2;
+    std::string layout = "grid";
+    double apSpacing = 20.0;
+    std::string channels = "36,40,44,48";
+    uint32_t minMcs = 3;
+    uint32_t maxMcs = 7;
+    double minDataRate = 1.0;
+    double maxDataRate = 5.0;
+    double apTxPower = 20.0;
+    double staTxPower = 15.0;
+    uint32_t seed = 1;
+    double roundTime = 2;
+    double numRounds = 10;
+    double roundWarmup = 1;
+    uint32_t printing = MonteCarloSimulator::MAX_ROUNDS;
+    double epsilonValue = 0.1;
+    std::string outputName = "enterprise-wlan";
+    bool profile = false;
+    std::string pipeline = "dynamic";
+    double ewmaAlpha = 0.3;
+    uint32_t rewardWindow = 5;
+    bool writeRewards = true;
+};
+
+struct Station
+{
+    Ptr<Node> node;
+    std::vector<uint32_t> interfaces; // IPv4 interface index per candidate AP
+    uint32_t firstFlow;               // index of the flow to the first candidate AP
+    uint32_t current;                 // currently associated candidate
+};
+
+std::vector<Station> stations;
+Ptr<UniformRandomVariable> policyRng;
+double* throughputSumArray;
+double* chooseArray;
+const double* pipelineRewards;
+double epsilonValue;
+std::chrono::steady_clock::time_point lastRoundWallTime;
+std::vector<double> roundWallTimes;
+
+// Bring up the interface of the selected candidate and bring down the previous one
+void Associate(Station& station, uint32_t candidate){
+    Ptr<Ipv4> ipv4 = station.node->GetObject<Ipv4>();
+    if (station.current != candidate)
+    {
+        ipv4->SetDown(station.interfaces[station.current]);
+    }
+    ipv4->SetUp(station.interfaces[candidate]);
+    station.current = candidate;
+}
+
+// Average throughput of the flow over the rounds in which it was active; 0 if never active
+double MeanThroughput(uint32_t flow){
+    return chooseArray[flow] > 0 ? throughputSumArray[flow] / chooseArray[flow] : 0;
+}
+
+// Reward of the flow: its mean throughput or the reward of the compile-time pipeline policy
+double FlowReward(uint32_t flow){
+    return pipelineRewards ? pipelineRewards[flow] : MeanThroughput(flow);
+}
+
+// Epsilon-greedy AP selection based on the rewards of the candidate flows
+void ChooseAPs(){
+    auto now = std::chrono::steady_clock::now();
+    roundWallTimes.push_back(std::chrono::duration<double>(now - lastRoundWallTime).count());
+    lastRoundWallTime = now;
+
+    for (auto& station : stations)
+    {
+        uint32_t candidate = 0;
+        if (policyRng->GetValue() < epsilonValue)
+        {
+            candidate = policyRng->GetInteger(0, station.interfaces.size() - 1);
+        }
+        else
+        {
+            for (uint32_t k = 1; k < station.interfaces.size(); ++k)
+            {
+                if (FlowReward(station.firstFlow + k) >
+                    FlowReward(station.firstFlow + candidate))
+                {
+                    candidate = k;
+                }
+            }
+        }
+        Associate(station, candidate);
+    }
+}
+
+std::vector<uint32_t> ParseChannels(const std::string& channels){
+    std::vector<uint32_t> parsed;
+    std::stringstream stream(channels);
+    std::string item;
+    while (std::getline(stream, item, ','))
+    {
+        parsed.push_back(std::stoul(item));
+    }
+    NS_ABORT_MSG_IF(parsed.empty(), "At least one channel number is required");
+    return parsed;
+}
+
+// Position of the index-th point on a regular grid with cols columns and the given spacing
+Vector GridPosition(uint32_t index, uint32_t cols, double spacing){
+    return Vector((index % cols) * spacing, (index / cols) * spacing, 0.0);
+}
+
+// Register the scenario parameters; the run number is set with the global --RngRun argument
+void AddScenarioValues(CommandLine& cmd, ScenarioConfig& config){
+    cmd.AddValue("nAps", "Number of access points", config.nAps);
+    cmd.AddValue("nStas", "Number of stations", config.nStas);
+    cmd.AddValue("candidates", "Number of candidate APs (interfaces) per station",
+                 config.candidates);
+    cmd.AddValue("layout", "Node placement. Available layouts: grid, random", config.layout);
+    cmd.AddValue("apSpacing", "Distance between neighbouring APs on the grid [m]",
+                 config.apSpacing);
+    cmd.AddValue("channels", "Comma-separated 20 MHz channel numbers assigned to APs "
+                             "round-robin", config.channels);
+    cmd.AddValue("minMcs", "Lowest HE MCS drawn for a station interface", config.minMcs);
+    cmd.AddValue("maxMcs", "Highest HE MCS drawn for a station interface", config.maxMcs);
+    cmd.AddValue("minDataRate", "Lowest per-station offered load [Mb/s]", config.minDataRate);
+    cmd.AddValue("maxDataRate", "Highest per-station offered load [Mb/s]", config.maxDataRate);
+    cmd.AddValue("apTxPower", "Transmit power of APs [dBm]", config.apTxPower);
+    cmd.AddValue("staTxPower", "Transmit power of stations [dBm]", config.staTxPower);
+    cmd.AddValue("seed", "Seed of the random number generator", config.seed);
+    cmd.AddValue("roundTime", "Duration of single round", config.roundTime);
+    cmd.AddValue("numRounds", "Number of rounds", config.numRounds);
+    cmd.AddValue("roundWarmup", "Warmup time for each round", config.roundWarmup);
+    cmd.AddValue("printing", "Number of stage from which results will be printed",
+                 config.printing);
+    cmd.AddValue("epsilonValue", "Value of epsilon parameter", config.epsilonValue);
+    cmd.AddValue("outputName", "Name of the output file with results", config.outputName);
+    cmd.AddValue("profile", "Count and time executed events per round and phase",
+                 config.profile);
+    cmd.AddValue("pipeline", "Round/reward pipeline. Available pipelines: dynamic "
+                             "(MonteCarloSimulator), mean, ewma, window, maxmin, pf "
+                             "(MonteCarloSimulatorT with the given reward policy)",
+                 config.pipeline);
+    cmd.AddValue("ewmaAlpha", "Weight of the last round in the ewma pipeline", config.ewmaAlpha);
+    cmd.AddValue("rewardWindow", "Number of active rounds averaged in the window pipeline",
+                 config.rewardWindow);
+    cmd.AddValue("writeRewards", "Write per-round rewards of the MonteCarloSimulatorT pipelines "
+                                 "to the output file", config.writeRewards);
+}
+
+// Run the configured simulation and report wall-clock time per round and peak memory
+void RunSimulation(const ScenarioConfig& config,
+                   ApplicationContainer& sourceApplications,
+                   ApplicationContainer& sinkApplications,
+                   std::chrono::steady_clock::time_point setupStart){
+    double stopTime = (config.numRounds + 1) * config.roundTime;
+    sinkApplications.Start (Seconds (0.0));
+    sinkApplications.Stop (Seconds (stopTime));
+    sourceApplications.Start (Seconds (0.0));
+    sourceApplications.Stop (Seconds (stopTime));
+
+    Simulator::Stop (Seconds (stopTime));
+
+    auto runStart = std::chrono::steady_clock::now();
+    lastRoundWallTime = runStart;
+    std::clog << std::endl << "Starting simulation with " << config.nAps << " APs, "
+              << config.nStas << " stations and " << sinkApplications.GetN() << " flows ("
+              << std::chrono::duration<double>(runStart - setupStart).count()
+              << " s setup)... " << std::endl;
+
+    Simulator::Run ();
+
+    // Report wall-clock time per round and peak memory, used to track scaling with flow count
+    double runTime =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - runStart).count();
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    double meanRoundTime = 0;
+    for (double roundWallTime : roundWallTimes)
+    {
+        meanRoundTime += roundWallTime;
+    }
+    if (!roundWallTimes.empty())
+    {
+        meanRoundTime /= roundWallTimes.size();
+    }
+    std::clog << "Flows: " << sinkApplications.GetN() << std::endl
+              << "Run time: " << runTime << " s" << std::endl
+              << "Mean wall time per round: " << meanRoundTime << " s" << std::endl
+              << "Peak resident set size: " << usage.ru_maxrss << " kB" << std::endl;
+}
+
+// Run the scenario with the MonteCarloSimulatorT pipeline composed of the given reward policy
+// and writer; APs are selected on the rewards of the policy after each round
+template <typename RewardPolicy, typename Writer>
+void RunPipeline(const ScenarioConfig& config,
+                 ApplicationContainer& sourceApplications,
+                 ApplicationContainer& sinkApplications,
+                 std::chrono::steady_clock::time_point setupStart,
+                 RewardPolicy rewardPolicy,
+                 Writer writer){
+    auto behaviour = [](uint32_t round, const RewardPolicy& rewards) {
+        pipelineRewards = rewards.GetRewards().data();
+        ChooseAPs();
+    };
+    MonteCarloSimulatorT<PacketSinkCollector, RewardPolicy, Writer, decltype(behaviour)>
+        monteCarloSimulator(PacketSinkCollector(&sinkApplications), std::move(rewardPolicy),
+                            std::move(writer), config.numRounds, config.roundTime,
+                            config.roundWarmup, behaviour);
+    RunSimulation(config, sourceApplications, sinkApplications, setupStart);
+}
+
+// Select the writer of the MonteCarloSimulatorT pipeline
+template <typename RewardPolicy>
+void RunPipeline(const ScenarioConfig& config,
+                 ApplicationContainer& sourceApplications,
+                 ApplicationContainer& sinkApplications,
+                 std::chrono::steady_clock::time_point setupStart,
+                 RewardPolicy rewardPolicy){
+    if (config.writeRewards)
+    {
+        RunPipeline(config, sourceApplications, sinkApplications, setupStart,
+                    std::move(rewardPolicy), CsvRewardWriter(config.outputName));
+    }
+    else
+    {
+        RunPipeline(config, sourceApplications, sinkApplications, setupStart,
+                    std::move(rewardPolicy), NullRewardWriter());
+    }
+}
+
+// Build and run a single scenario; returns non-zero for invalid configurations
+int RunScenario(const ScenarioConfig& config){
+    if (config.roundWarmup >= config.roundTime){
+        std::cout << "Warmup time cannot exceed time of a single round" << std::endl;
+        return 1;
+    }
+
+    if (!(config.layout == "grid" || config.layout == "random")){
+        std::cout << "Unsupported layout" << std::endl;
+        return 1;
+    }
+
+    if (config.nAps == 0 || config.nStas == 0 || config.candidates == 0){
+        std::cout << "Number of APs, stations and candidates must be positive" << std::endl;
+        return 1;
+    }
+
+    if (config.minMcs > config.maxMcs || config.maxMcs > 11){
+        std::cout << "MCS range should be within <0, 11>" << std::endl;
+        return 1;
+    }
+
+    if (config.minDataRate > config.maxDataRate){
+        std::cout << "Minimum data rate cannot exceed maximum data rate" << std::endl;
+        return 1;
+    }
+
+    const std::vector<std::string> pipelines = {"dynamic", "mean", "ewma", "window", "maxmin",
+                                                "pf"};
+    if (std::find(pipelines.begin(), pipelines.end(), config.pipeline) == pipelines.end()){
+        std::cout << "Unsupported pipeline" << std::endl;
+        return 1;
+    }
+
+    if (config.profile && config.pipeline != "dynamic"){
+        std::cout << "Profiling is supported with the dynamic pipeline only" << std::endl;
+        return 1;
+    }
+
+    if (config.ewmaAlpha <= 0 || config.ewmaAlpha > 1 || config.rewardWindow == 0){
+        std::cout << "EWMA weight should be within (0, 1] and the window must be positive"
+                  << std::endl;
+        return 1;
+    }
+
+    // The profiler replaces the simulator implementation, so it must be selected first
+    if (config.profile)
+    {
+        MonteCarloProfiler::Install();
+    }
+
+    auto setupStart = std::chrono::steady_clock::now();
+
+    RngSeedManager::SetSeed(config.seed);
+    Ptr<UniformRandomVariable> scenarioRng = CreateObject<UniformRandomVariable>();
+    policyRng = CreateObject<UniformRandomVariable>();
+    epsilonValue = config.epsilonValue;
+
+    uint32_t candidates = std::min(config.candidates, config.nAps);
+    std::vector<uint32_t> channelNumbers = ParseChannels(config.channels);
+
+    NodeContainer wifiApNodes;
+    NodeContainer wifiStaNodes;
+    wifiApNodes.Create(config.nAps);
+    wifiStaNodes.Create(config.nStas);
+
+    // Configure mobility; APs and stations share a square area covering the AP grid
+    uint32_t apCols = std::ceil(std::sqrt(config.nAps));
+    double side = apCols * config.apSpacing;
+    std::vector<Vector> apPositions;
+    std::vector<Vector> staPositions;
+    for (uint32_t apIndex = 0; apIndex < config.nAps; ++apIndex)
+    {
+        if (config.layout == "grid")
+        {
+            apPositions.push_back(GridPosition(apIndex, apCols, config.apSpacing));
+        }
+        else
+        {
+            apPositions.push_back(Vector(scenarioRng->GetValue(0, side),
+                                         scenarioRng->GetValue(0, side), 0.0));
+        }
+    }
+    uint32_t staCols = std::ceil(std::sqrt(config.nStas));
+    for (uint32_t staIndex = 0; staIndex < config.nStas; ++staIndex)
+    {
+        if (config.layout == "grid")
+        {
+            staPositions.push_back(GridPosition(staIndex, staCols, side / staCols));
+        }
+        else
+        {
+            staPositions.push_back(Vector(scenarioRng->GetValue(0, side),
+                                          scenarioRng->GetValue(0, side), 0.0));
+        }
+    }
+
+    MobilityHelper mobility;
+    Ptr<ListPositionAllocator> positionAlloc = CreateObject<ListPositionAllocator> ();
+    for (const auto& position : apPositions)
+    {
+        positionAlloc->Add(position);
+    }
+    for (const auto& position : staPositions)
+    {
+        positionAlloc->Add(position);
+    }
+    mobility.SetPositionAllocator (positionAlloc);
+    mobility.SetMobilityModel ("ns3::ConstantPositionMobilityModel");
+    mobility.Install (wifiApNodes);
+    mobility.Install (wifiStaNodes);
+
+    // Select candidate APs for every station (the nearest ones) and group stations per AP
+    std::vector<std::vector<uint32_t>> apStations(config.nAps);
+    std::vector<std::vector<uint32_t>> staCandidates(config.nStas);
+    std::vector<uint32_t> apOrder(config.nAps);
+    for (uint32_t staIndex = 0; staIndex < config.nStas; ++staIndex)
+    {
+        for (uint32_t apIndex = 0; apIndex < config.nAps; ++apIndex)
+        {
+            apOrder[apIndex] = apIndex;
+        }
+        const Vector& staPosition = staPositions[staIndex];
+        std::partial_sort(apOrder.begin(), apOrder.begin() + candidates, apOrder.end(),
+                          [&](uint32_t a, uint32_t b) {
+                              return CalculateDistance(apPositions[a], staPosition) <
+                                     CalculateDistance(apPositions[b], staPosition);
+                          });
+        staCandidates[staIndex].assign(apOrder.begin(), apOrder.begin() + candidates);
+        for (uint32_t apIndex : staCandidates[staIndex])
+        {
+            apStations[apIndex].push_back(staIndex);
+        }
+    }
+
+    // Configure one wireless channel per channel number, shared by all APs using it
+    std::map<uint32_t, Ptr<YansWifiChannel>> wifiChannels;
+    Ptr<LogDistancePropagationLossModel> lossModel =
+        CreateObject<LogDistancePropagationLossModel>();
+    for (uint32_t channelNumber : channelNumbers)
+    {
+        Ptr<YansWifiChannel> wifiChannel = CreateObject<YansWifiChannel>();
+        wifiChannel->SetPropagationLossModel(lossModel);
+        wifiChannel->SetPropagationDelayModel(
+            CreateObject<ConstantSpeedPropagationDelayModel>());
+        wifiChannels[channelNumber] = wifiChannel;
+    }
+
+    WifiMacHelper mac;
+    mac.SetType ("ns3::AdhocWifiMac");
+    WifiHelper wifi;
+    wifi.SetStandard (WIFI_STANDARD_80211ax);
+    wifi.SetRemoteStationManager ("ns3::ConstantRateWifiManager",
+                                  "DataMode", StringValue ("HeMcs0"),
+                                  "ControlMode", StringValue ("HeMcs0"));
+    YansWifiPhyHelper phy;
+
+    InternetStackHelper stack;
+    stack.Install (wifiApNodes);
+    stack.Install (wifiStaNodes);
+
+    Ipv4AddressHelper address;
+    address.SetBase ("10.0.0.0", "255.255.240.0");
+
+    // Station devices indexed by candidate, filled while installing AP by AP
+    std::vector<std::vector<Ptr<WifiNetDevice>>> staDevices(
+        config.nStas, std::vector<Ptr<WifiNetDevice>>(candidates));
+    std::vector<Ipv4Address> apAddresses(config.nAps);
+    for (uint32_t apIndex = 0; apIndex < config.nAps; ++apIndex)
+    {
+        uint32_t channelNumber = channelNumbers[apIndex % channelNumbers.size()];
+        phy.SetChannel (wifiChannels[channelNumber]);
+        phy.Set ("ChannelSettings",
+                 StringValue ("{" + std::to_string(channelNumber) + ", 20, BAND_5GHZ, 0}"));
+
+        NodeContainer staNodes;
+        for (uint32_t staIndex : apStations[apIndex])
+        {
+            staNodes.Add(wifiStaNodes.Get(staIndex));
+        }
+        NetDeviceContainer apDevice = wifi.Install (phy, mac, wifiApNodes.Get(apIndex));
+        NetDeviceContainer devices = wifi.Install (phy, mac, staNodes);
+
+        // Set per-device attributes directly on the objects
+        Ptr<WifiNetDevice> apWifiDevice = DynamicCast<WifiNetDevice>(apDevice.Get(0));
+        apWifiDevice->GetPhy()->SetTxPowerStart(config.apTxPower);
+        apWifiDevice->GetPhy()->SetTxPowerEnd(config.apTxPower);
+        apWifiDevice->GetHeConfiguration()->SetGuardInterval(NanoSeconds(800));
+        for (uint32_t deviceIndex = 0; deviceIndex < devices.GetN(); ++deviceIndex)
+        {
+            Ptr<WifiNetDevice> wifiDevice = DynamicCast<WifiNetDevice>(devices.Get(deviceIndex));
+            std::string mcs = "HeMcs" + std::to_string(
+                scenarioRng->GetInteger(config.minMcs, config.maxMcs));
+            wifiDevice->GetRemoteStationManager()->SetAttribute("DataMode", StringValue(mcs));
+            wifiDevice->GetRemoteStationManager()->SetAttribute("ControlMode", StringValue(mcs));
+            wifiDevice->GetPhy()->SetTxPowerStart(config.staTxPower);
+            wifiDevice->GetPhy()->SetTxPowerEnd(config.staTxPower);
+            wifiDevice->GetHeConfiguration()->SetGuardInterval(NanoSeconds(800));
+            const auto& candidateList = staCandidates[apStations[apIndex][deviceIndex]];
+            uint32_t k = std::find(candidateList.begin(), candidateList.end(), apIndex) -
+                         candidateList.begin();
+            staDevices[apStations[apIndex][deviceIndex]][k] = wifiDevice;
+        }
+
+        // Every AP and the station interfaces towards it form a separate subnet
+        apAddresses[apIndex] = address.Assign (apDevice).GetAddress(0);
+        address.Assign (devices);
+        address.NewNetwork();
+    }
+
+    // Install applications (traffic generators), one flow per (station, candidate AP) pair
+    ApplicationContainer sourceApplications;
+    ApplicationContainer sinkApplications;
+    std::vector<uint16_t> apPorts(config.nAps, 9);
+    stations.resize(config.nStas);
+    for (uint32_t staIndex = 0; staIndex < config.nStas; ++staIndex)
+    {
+        Station& station = stations[staIndex];
+        station.node = wifiStaNodes.Get(staIndex);
+        station.firstFlow = sinkApplications.GetN();
+        station.current = 0;
+        Ptr<Ipv4> ipv4 = station.node->GetObject<Ipv4>();
+        double dataRate = scenarioRng->GetValue(config.minDataRate, config.maxDataRate);
+        for (uint32_t k = 0; k < candidates; ++k)
+        {
+            uint32_t apIndex = staCandidates[staIndex][k];
+            station.interfaces.push_back(ipv4->GetInterfaceForDevice(staDevices[staIndex][k]));
+
+            InetSocketAddress sinkSocket (apAddresses[apIndex], apPorts[apIndex]++);
+            OnOffHelper onOffHelper ("ns3::UdpSocketFactory", sinkSocket);
+            onOffHelper.SetConstantRate(DataRate(dataRate * 1e6), 1472);
+            sourceApplications.Add (onOffHelper.Install (station.node));
+            PacketSinkHelper packetSinkHelper ("ns3::UdpSocketFactory", sinkSocket);
+            sinkApplications.Add (packetSinkHelper.Install (wifiApNodes.Get (apIndex)));
+        }
+        // Initialize simulation at random
+        for (uint32_t interface : station.interfaces)
+        {
+            ipv4->SetDown(interface);
+        }
+        Associate(station, policyRng->GetInteger(0, candidates - 1));
+    }
+
+    pipelineRewards = nullptr;
+    if (config.pipeline == "dynamic")
+    {
+        MonteCarloSimulator monteCarloSimulator = MonteCarloSimulator(
+            &sinkApplications, config.numRounds, config.roundTime, config.roundWarmup,
+            config.outputName, config.printing, true,
+            &ChooseAPs);
+        throughputSumArray = monteCarloSimulator.GetThroughputSumArray();
+        chooseArray = monteCarloSimulator.GetChooseArray();
+        if (config.profile)
+        {
+            monteCarloSimulator.EnableProfiling();
+        }
+        RunSimulation(config, sourceApplications, sinkApplications, setupStart);
+    }
+    else if (config.pipeline == "mean")
+    {
+        RunPipeline(config, sourceApplications, sinkApplications, setupStart,
+                    RunningMeanReward());
+    }
+    else if (config.pipeline == "ewma")
+    {
+        RunPipeline(config, sourceApplications, sinkApplications, setupStart,
+                    EwmaReward(config.ewmaAlpha));
+    }
+    else if (config.pipeline == "window")
+    {
+        RunPipeline(config, sourceApplications, sinkApplications, setupStart,
+                    SlidingWindowReward(config.rewardWindow));
+    }
+    else if (config.pipeline == "maxmin")
+    {
+        RunPipeline(config, sourceApplications, sinkApplications, setupStart,
+                    MaxMinFairnessReward());
+    }
+    else
+    {
+        RunPipeline(config, sourceApplications, sinkApplications, setupStart,
+                    ProportionalFairnessReward());
+    }
+
+    //Clean-up
+    Simulator::Destroy ();
+
+    return 0;
+}
+
+int main (int argc, char *argv[]){
+    ScenarioConfig config;
+    std::string queueDir;
+    std::string sweep;
+    uint32_t replications = 0;
+
+    CommandLine cmd;
+    AddScenarioValues(cmd, config);
+    cmd.AddValue("queueDir", "Shared directory of the job queue; if set, the program works as "
+                             "a worker running jobs of the campaign", queueDir);
+    cmd.AddValue("sweep", "Semicolon-separated arguments of sweep points used to create the "
+                          "campaign, e.g. \"--nStas=100;--nStas=200\"", sweep);
+    cmd.AddValue("replications", "Number of replications of each sweep point; if positive, "
+                                 "the campaign is created unless it exists", replications);
+    cmd.Parse (argc,argv);
+
+    if (queueDir.empty()){
+        return RunScenario(config);
+    }
+
+    if (replications > 0){
+        std::vector<std::string> sweepPoints;
+        std::stringstream stream(sweep);
+        std::string point;
+        while (std::getline(stream, point, ';'))
+        {
+            sweepPoints.push_back(point);
+        }
+        if (sweepPoints.empty())
+        {
+            sweepPoints.push_back("");
+        }
+        MonteCarloJobQueue::CreateCampaign(queueDir, sweepPoints, replications);
+    }
+
+    // Run jobs until the campaign is finished; every job runs in a child process, so that
+    // no simulator or random number generator state is shared between jobs. The heartbeat
+    // thread is started after forking, so that the child is forked from a single thread
+    MonteCarloJobQueue queue(queueDir);
+    MonteCarloJobQueue::Job job;
+    pid_t worker = getpid();
+    while (queue.Claim(job, false))
+    {
+        pid_t child = fork();
+        if (child == 0)
+        {
+#ifdef __linux__
+            // Do not outlive the worker, whose claim is reclaimed by another worker
+            prctl(PR_SET_PDEATHSIG, SIGKILL);
+#endif
+            if (getppid() != worker)
+            {
+                _exit(1);
+            }
+            // Job arguments override the command line
+            ScenarioConfig jobConfig = config;
+            CommandLine jobCmd;
+            AddScenarioValues(jobCmd, jobConfig);
+            std::vector<std::string> arguments = {argv[0]};
+            arguments.insert(arguments.end(), job.arguments.begin(), job.arguments.end());
+            jobCmd.Parse(arguments);
+            jobConfig.outputName = job.outputName;
+            _exit(RunScenario(jobConfig));
+        }
+        if (child > 0)
+        {
+            queue.StartHeartbeat(job);
+        }
+        int status = 0;
+        if (child < 0 || waitpid(child, &status, 0) < 0 || !WIFEXITED(status) ||
+            WEXITSTATUS(status) != 0)
+        {
+            // The claim is released, so that the job is retried
+            std::cout << "Job " << job.id << " failed" << std::endl;
+            queue.Fail(job);
+        }
+        else
+        {
+            queue.Complete(job);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,348 @@
+#include "MonteCarloJobQueue.h"
+
+#include "ns3/abort.h"
+#include "ns3/log.h"
+#include "ns3/system-path.h"
+#include "cerrno"
+#include "chrono"
+#include "cstdio"
+#include "cstring"
+#include "fstream"
+#include "sstream"
+#include "dirent.h"
+#include "fcntl.h"
+#include "sys/stat.h"
+#include "sys/time.h"
+#include "unistd.h"
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("MonteCarloJobQueue");
+
+MonteCarloJobQueue::MonteCarloJobQueue(std::string directory,
+                                       double staleTimeout,
+                                       double heartbeatInterval,
+                                       double pollInterval,
+                                       uint32_t maxAttempts)
+{
+    queueDirectory = directory;
+    stale = staleTimeout;
+    heartbeat = heartbeatInterval;
+    poll = pollInterval;
+    attempts = maxAttempts;
+    NS_ABORT_MSG_IF(heartbeat >= stale, "Heartbeat interval must be shorter than stale timeout");
+
+    char hostname[256] = {0};
+    gethostname(hostname, sizeof(hostname) - 1);
+    // Several queues of one process act as separate workers
+    static uint32_t queueCount = 0;
+    workerName = std::string(hostname) + "." + std::to_string(getpid()) + "." +
+                 std::to_string(queueCount++);
+
+    SystemPath::MakeDirectories(queueDirectory + "/claims");
+    SystemPath::MakeDirectories(queueDirectory + "/done");
+    SystemPath::MakeDirectories(queueDirectory + "/failed");
+    SystemPath::MakeDirectories(queueDirectory + "/attempts");
+    SystemPath::MakeDirectories(queueDirectory + "/results");
+}
+
+MonteCarloJobQueue::~MonteCarloJobQueue()
+{
+    StopHeartbeat();
+}
+
+void
+MonteCarloJobQueue::CreateCampaign(const std::string& directory,
+                                   const std::vector<std::string>& sweepPoints,
+                                   uint32_t replications)
+{
+    std::string campaign = directory + "/campaign.txt";
+    if (std::ifstream(campaign).good())
+    {
+        return;
+    }
+    SystemPath::MakeDirectories(directory);
+
+    // Write to a private file first, so that concurrent workers never read a partial descriptor
+    std::string temporary = campaign + "." + std::to_string(getpid());
+    std::ofstream outputFile(temporary);
+    for (uint32_t point = 0; point < sweepPoints.size(); ++point)
+    {
+        for (uint32_t replication = 1; replication <= replications; ++replication)
+        {
+            outputFile << "point" << point << "-run" << replication << " " << sweepPoints[point]
+                       << " --RngRun=" << replication << std::endl;
+        }
+    }
+    outputFile.close();
+    NS_ABORT_MSG_IF(std::rename(temporary.c_str(), campaign.c_str()) != 0,
+                    "Cannot create campaign descriptor " << campaign);
+}
+
+bool
+MonteCarloJobQueue::Claim(Job& job, bool heartbeat)
+{
+    while (true)
+    {
+        bool allDone = true;
+        for (const auto& candidate : ReadCampaign())
+        {
+            if (FileExists(queueDirectory + "/done/" + candidate.id) ||
+                GetFailures(candidate.id) >= attempts)
+            {
+                continue;
+            }
+            allDone = false;
+            if (!TryClaim(candidate.id) &&
+                !(IsStale(candidate.id) && Reclaim(candidate.id) && TryClaim(candidate.id)))
+            {
+                continue;
+            }
+            // The job might have been finished between the check and the claim
+            std::string claimPath = queueDirectory + "/claims/" + candidate.id;
+            if (FileExists(queueDirectory + "/done/" + candidate.id) ||
+                GetFailures(candidate.id) >= attempts)
+            {
+                std::remove(claimPath.c_str());
+                continue;
+            }
+            job = candidate;
+            job.outputName += "." + workerName;
+            if (heartbeat)
+            {
+                StartHeartbeat(job);
+            }
+            NS_LOG_INFO("Worker " << workerName << " claimed job " << job.id);
+            return true;
+        }
+        if (allDone)
+        {
+            return false;
+        }
+        std::this_thread::sleep_for(std::chrono::duration<double>(poll));
+    }
+}
+
+void
+MonteCarloJobQueue::Complete(const Job& job)
+{
+    StopHeartbeat();
+    std::string results = queueDirectory + "/results/" + job.id;
+    for (const std::string suffix : {".csv", "-profile.csv"})
+    {
+        if (FileExists(job.outputName + suffix))
+        {
+            NS_ABORT_MSG_IF(
+                std::rename((job.outputName + suffix).c_str(), (results + suffix).c_str()) != 0,
+                "Cannot move results of job " << job.id);
+        }
+    }
+    std::string done = queueDirectory + "/done/" + job.id;
+    std::string temporary = done + "." + workerName;
+    std::ofstream(temporary) << workerName << std::endl;
+    NS_ABORT_MSG_IF(std::rename(temporary.c_str(), done.c_str()) != 0,
+                    "Cannot mark job " << job.id << " as completed");
+    std::remove((queueDirectory + "/claims/" + job.id).c_str());
+    RemoveAttempts(job.id);
+    NS_LOG_INFO("Worker " << workerName << " completed job " << job.id);
+}
+
+void
+MonteCarloJobQueue::Fail(const Job& job)
+{
+    StopHeartbeat();
+    std::remove((job.outputName + ".csv").c_str());
+    std::remove((job.outputName + "-profile.csv").c_str());
+    // Only the claim holder updates the counter, so the update does not race
+    std::string failed = queueDirectory + "/failed/" + job.id;
+    std::string temporary = failed + "." + workerName;
+    uint32_t failures = GetFailures(job.id) + 1;
+    std::ofstream(temporary) << failures << std::endl;
+    NS_ABORT_MSG_IF(std::rename(temporary.c_str(), failed.c_str()) != 0,
+                    "Cannot count failed attempt of job " << job.id);
+    std::remove((queueDirectory + "/claims/" + job.id).c_str());
+    if (failures >= attempts)
+    {
+        RemoveAttempts(job.id);
+    }
+    NS_LOG_INFO("Worker " << workerName << " failed job " << job.id);
+}
+
+uint32_t
+MonteCarloJobQueue::GetFailures(const std::string& id)
+{
+    uint32_t failures = 0;
+    std::ifstream(queueDirectory + "/failed/" + id) >> failures;
+    return failures;
+}
+
+void
+MonteCarloJobQueue::RemoveAttempts(const std::string& id)
+{
+    std::string attemptsDirectory = queueDirectory + "/attempts";
+    DIR* directory = opendir(attemptsDirectory.c_str());
+    if (!directory)
+    {
+        return;
+    }
+    // The trailing dot keeps e.g. point0-run10 apart from point0-run1
+    std::string prefix = id + ".";
+    while (struct dirent* entry = readdir(directory))
+    {
+        std::string name = entry->d_name;
+        if (name.compare(0, prefix.size(), prefix) == 0)
+        {
+            std::remove((attemptsDirectory + "/" + name).c_str());
+        }
+    }
+    closedir(directory);
+}
+
+std::vector<MonteCarloJobQueue::Job>
+MonteCarloJobQueue::ReadCampaign()
+{
+    std::string campaignPath = queueDirectory + "/campaign.txt";
+    while (!FileExists(campaignPath))
+    {
+        NS_LOG_INFO("Worker " << workerName << " waits for campaign descriptor " << campaignPath);
+        std::this_thread::sleep_for(std::chrono::duration<double>(poll));
+    }
+    std::ifstream campaign(campaignPath);
+    std::vector<Job> jobs;
+    std::string line;
+    while (std::getline(campaign, line))
+    {
+        std::istringstream tokens(line);
+        Job job;
+        if (!(tokens >> job.id) || job.id[0] == '#')
+        {
+            continue;
+        }
+        NS_ABORT_MSG_IF(job.id.find('/') != std::string::npos,
+                        "Job identifier " << job.id << " cannot contain '/'");
+        std::string argument;
+        while (tokens >> argument)
+        {
+            job.arguments.push_back(argument);
+        }
+        job.outputName = queueDirectory + "/attempts/" + job.id;
+        jobs.push_back(job);
+    }
+    return jobs;
+}
+
+bool
+MonteCarloJobQueue::TryClaim(const std::string& id)
+{
+    // Exclusive creation is atomic on local file systems and on NFSv3 and newer
+    std::string claimPath = queueDirectory + "/claims/" + id;
+    int descriptor = open(claimPath.c_str(), O_CREAT | O_EXCL | O_WRONLY, 0644);
+    if (descriptor < 0)
+    {
+        NS_ABORT_MSG_IF(errno != EEXIST,
+                        "Cannot create claim " << claimPath << ": " << std::strerror(errno));
+        return false;
+    }
+    std::string owner = workerName + "\n";
+    if (write(descriptor, owner.c_str(), owner.size()) < 0)
+    {
+        NS_LOG_WARN("Cannot write owner of claim " << claimPath);
+    }
+    close(descriptor);
+    observedClaims.erase(id);
+    return true;
+}
+
+bool
+MonteCarloJobQueue::IsStale(const std::string& id)
+{
+    struct stat status;
+    if (stat((queueDirectory + "/claims/" + id).c_str(), &status) != 0)
+    {
+        // The claim was released in the meantime
+        observedClaims.erase(id);
+        return false;
+    }
+    std::time_t now = std::time(nullptr);
+    auto it = observedClaims.find(id);
+    if (it == observedClaims.end() || it->second.first != status.st_mtime)
+    {
+        // Only the local clock is used, so clock skew between hosts does not matter
+        observedClaims[id] = std::make_pair(status.st_mtime, now);
+        return false;
+    }
+    return std::difftime(now, it->second.second) >= stale;
+}
+
+bool
+MonteCarloJobQueue::Reclaim(const std::string& id)
+{
+    std::string claimPath = queueDirectory + "/claims/" + id;
+    std::string stalePath = claimPath + ".stale." + workerName;
+    std::time_t observed = observedClaims[id].first;
+    observedClaims.erase(id);
+    // Only one of the competing workers succeeds in renaming the claim
+    if (std::rename(claimPath.c_str(), stalePath.c_str()) != 0)
+    {
+        return false;
+    }
+    struct stat status;
+    if (stat(stalePath.c_str(), &status) == 0 && status.st_mtime != observed)
+    {
+        // A live claim was renamed, put it back unless the job was claimed again already
+        if (link(stalePath.c_str(), claimPath.c_str()) != 0)
+        {
+            NS_LOG_WARN("Claim of job " << id << " was taken over while reclaiming");
+        }
+        std::remove(stalePath.c_str());
+        return false;
+    }
+    std::remove(stalePath.c_str());
+    NS_LOG_INFO("Worker " << workerName << " reclaimed stale job " << id);
+    return true;
+}
+
+void
+MonteCarloJobQueue::StartHeartbeat(const Job& job)
+{
+    StopHeartbeat();
+    std::string claimPath = queueDirectory + "/claims/" + job.id;
+    stopHeartbeat = false;
+    heartbeatThread = std::thread([this, claimPath]() {
+        std::unique_lock<std::mutex> lock(heartbeatMutex);
+        while (!heartbeatCondition.wait_for(lock,
+                                            std::chrono::duration<double>(heartbeat),
+                                            [this]() { return stopHeartbeat; }))
+        {
+            // Setting the current time lets the file server stamp the modification time
+            if (utimes(claimPath.c_str(), nullptr) != 0)
+            {
+                NS_LOG_WARN("Cannot update heartbeat of " << claimPath);
+            }
+        }
+    });
+}
+
+void
+MonteCarloJobQueue::StopHeartbeat()
+{
+    if (heartbeatThread.joinable())
+    {
+        {
+            std::lock_guard<std::mutex> lock(heartbeatMutex);
+            stopHeartbeat = true;
+        }
+        heartbeatCondition.notify_all();
+        heartbeatThread.join();
+    }
+}
+
+bool
+MonteCarloJobQueue::FileExists(const std::string& filename)
+{
+    std::ifstream f(filename.c_str());
+    return f.good();
+}
+
+}
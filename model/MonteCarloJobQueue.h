@@ -0,0 +1,186 @@
+/*
+ * Copyright (c) 2023 AGH University of Science and Technology
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#ifndef MONTECARLOJOBQUEUE_H
+#define MONTECARLOJOBQUEUE_H
+
+#include <condition_variable>
+#include <ctime>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace ns3
+{
+/**
+ * \ingroup MonteCarloSimulator
+ *
+ * File-based work queue used to spread replications and sweep points of a campaign across
+ * worker processes sharing a directory (a local directory or e.g. an NFS mount). The directory
+ * contains:
+ * - campaign.txt: the campaign descriptor, one job per line in the form
+ *   "jobId --argument=value ...", empty lines and lines starting with # are ignored,
+ * - claims/jobId: created exclusively by the worker running the job and touched periodically
+ *   as a heartbeat,
+ * - done/jobId: marker of a completed job,
+ * - failed/jobId: number of failed attempts of the job,
+ * - attempts/jobId.workerName.csv: results of a running attempt of the job,
+ * - results/jobId.csv: results of the completed job.
+ *
+ * Every attempt writes its results under a private output name in attempts/, renamed to
+ * results/jobId on completion, so that a run orphaned by a dead worker never mixes its rows
+ * with the results of the attempt which reclaimed the job. Partial results of reclaimed or
+ * killed attempts are removed once the job is completed or no longer retried. A failed attempt
+ * releases the claim, so that the job is retried, until the number of failed attempts reaches
+ * maxAttempts. Workers started before the campaign descriptor is created wait for it.
+ *
+ * A claim whose modification time did not change for staleTimeout seconds, as observed by the
+ * local clock of the polling worker, belongs to a dead worker and is reclaimed by renaming it.
+ * Modification times may have a resolution of one second, so staleTimeout should exceed
+ * heartbeatInterval by more than one second.
+ */
+class MonteCarloJobQueue
+{
+  public:
+    /**
+     * A single replication or sweep point of the campaign
+     */
+    struct Job
+    {
+        std::string id;                      //!< identifier of the job
+        std::vector<std::string> arguments;  //!< command-line arguments of the job
+        std::string outputName;              //!< private output name of this attempt
+    };
+
+    /**
+     * The constructor of the work queue; creates the queue subdirectories if necessary
+     * @param directory the shared directory with the campaign descriptor
+     * @param staleTimeout time in seconds after which a claim without a heartbeat is reclaimed
+     * @param heartbeatInterval time in seconds between heartbeats of the claimed job
+     * @param pollInterval time in seconds between scans when no job can be claimed
+     * @param maxAttempts number of failed attempts after which a job is no longer retried
+     */
+    MonteCarloJobQueue(std::string directory, double staleTimeout = 300,
+                       double heartbeatInterval = 10, double pollInterval = 5,
+                       uint32_t maxAttempts = 3);
+    ~MonteCarloJobQueue();
+
+    /**
+     * Write the campaign descriptor with every sweep point repeated for each replication, unless
+     * the descriptor already exists; replication r of a point gets the "--RngRun=r" argument
+     * @param directory the shared directory of the queue
+     * @param sweepPoints command-line arguments of each sweep point, separated by spaces
+     * @param replications number of replications of each sweep point
+     */
+    static void CreateCampaign(const std::string& directory,
+                               const std::vector<std::string>& sweepPoints,
+                               uint32_t replications);
+    /**
+     * Claim a job of the campaign which is neither completed, nor failed maxAttempts times, nor
+     * claimed by a live worker; waits while the remaining jobs are being run by other workers
+     * @param job the claimed job
+     * @param heartbeat start the heartbeat of the claim; processes forking after the claim
+     * should pass false and call StartHeartbeat after the fork, so that no thread is running
+     * while forking
+     * @return true if a job was claimed or false if all jobs of the campaign are finished
+     */
+    bool Claim(Job& job, bool heartbeat = true);
+    /**
+     * Start periodically touching the claim file of the job
+     * @param job the claimed job
+     */
+    void StartHeartbeat(const Job& job);
+    /**
+     * Move the results of the claimed job to results/jobId, mark the job as completed and
+     * release its claim; outputName.csv and outputName-profile.csv are moved if they exist
+     * @param job the completed job
+     */
+    void Complete(const Job& job);
+    /**
+     * Discard the results of the claimed job, count the failed attempt and release the claim,
+     * so that the job can be retried by any worker
+     * @param job the failed job
+     */
+    void Fail(const Job& job);
+
+  private:
+    std::string queueDirectory;
+    double stale;
+    double heartbeat;
+    double poll;
+    uint32_t attempts;
+    std::string workerName;
+    std::map<std::string, std::pair<std::time_t, std::time_t>> observedClaims;
+    std::thread heartbeatThread;
+    std::mutex heartbeatMutex;
+    std::condition_variable heartbeatCondition;
+    bool stopHeartbeat = false;
+
+    /**
+     * Read the jobs listed in the campaign descriptor, waiting until the descriptor is created
+     * @return the jobs of the campaign
+     */
+    std::vector<Job> ReadCampaign();
+    /**
+     * Try to create the claim file of the job exclusively
+     * @param id identifier of the job
+     * @return true if the claim was created by this worker
+     */
+    bool TryClaim(const std::string& id);
+    /**
+     * Check whether the claim of the job did not change for the stale timeout; the first
+     * observation of a claim starts its timeout
+     * @param id identifier of the job
+     * @return true if the claim belongs to a dead worker
+     */
+    bool IsStale(const std::string& id);
+    /**
+     * Remove the stale claim of the job, unless another worker reclaimed it in the meantime
+     * @param id identifier of the job
+     * @return true if the stale claim was removed by this worker
+     */
+    bool Reclaim(const std::string& id);
+    /**
+     * Return the number of failed attempts of the job
+     * @param id identifier of the job
+     * @return the number of failed attempts
+     */
+    uint32_t GetFailures(const std::string& id);
+    /**
+     * Remove the results of all attempts of the job left in attempts/
+     * @param id identifier of the job
+     */
+    void RemoveAttempts(const std::string& id);
+    /**
+     * Stop the heartbeat thread, if running
+     */
+    void StopHeartbeat();
+    /**
+     * Function to check whether the file exists
+     * @param filename path of the file
+     * @return true if the file exists or false in the other case
+     */
+    bool FileExists(const std::string& filename);
+};
+
+}
+
+#endif /* MONTECARLOJOBQUEUE_H */
@@ -0,0 +1,169 @@
+#include "MonteCarloProfiler.h"
+
+#include "ns3/global-value.h"
+#include "ns3/log.h"
+#include "ns3/string.h"
+#include "chrono"
+#include "cstdlib"
+#include "cxxabi.h"
+
+namespace ns3
+{
+
+NS_LOG_COMPONENT_DEFINE("MonteCarloProfiler");
+
+NS_OBJECT_ENSURE_REGISTERED(MonteCarloProfiler);
+
+/**
+ * Event forwarding the execution to the wrapped event and reporting its duration
+ */
+class MonteCarloProfiledEvent : public EventImpl
+{
+  public:
+    MonteCarloProfiledEvent(EventImpl* event, MonteCarloProfiler* profiler)
+        : wrappedEvent(event),
+          category(typeid(*event)),
+          eventProfiler(profiler)
+    {
+    }
+
+    ~MonteCarloProfiledEvent() override
+    {
+        wrappedEvent->Unref();
+    }
+
+  private:
+    void Notify() override
+    {
+        auto start = std::chrono::steady_clock::now();
+        wrappedEvent->Invoke();
+        eventProfiler->Record(
+            category,
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+
+    EventImpl* wrappedEvent;
+    std::type_index category;
+    MonteCarloProfiler* eventProfiler;
+};
+
+TypeId
+MonteCarloProfiler::GetTypeId()
+{
+    static TypeId tid = TypeId("ns3::MonteCarloProfiler")
+                            .SetParent<DefaultSimulatorImpl>()
+                            .SetGroupName("MonteCarloSimulator")
+                            .AddConstructor<MonteCarloProfiler>();
+    return tid;
+}
+
+MonteCarloProfiler::MonteCarloProfiler()
+{
+}
+
+MonteCarloProfiler::~MonteCarloProfiler()
+{
+}
+
+void
+MonteCarloProfiler::Install()
+{
+    GlobalValue::Bind("SimulatorImplementationType",
+                      StringValue(MonteCarloProfiler::GetTypeId().GetName()));
+}
+
+void
+MonteCarloProfiler::SetOutputFile(const std::string& filename)
+{
+    outputFile.open(filename, std::ios::trunc);
+    outputFile << "StageNumber,Phase,Event,Count,Time" << std::endl;
+}
+
+void
+MonteCarloProfiler::SetPhase(uint32_t round, Phase phase)
+{
+    phaseSwitchPending = true;
+    nextRound = round;
+    nextPhase = phase;
+}
+
+void
+MonteCarloProfiler::Flush()
+{
+    if (outputFile.is_open())
+    {
+        for (const auto& entry : statistics)
+        {
+            outputFile << currentRound << ","
+                       << (currentPhase == WARMUP ? "Warmup" : "Measurement") << ",\""
+                       << GetCategoryName(entry.first) << "\"," << entry.second.count << ","
+                       << entry.second.seconds << std::endl;
+        }
+    }
+    statistics.clear();
+}
+
+void
+MonteCarloProfiler::Destroy()
+{
+    Flush();
+    outputFile.close();
+    DefaultSimulatorImpl::Destroy();
+}
+
+EventId
+MonteCarloProfiler::Schedule(const Time& delay, EventImpl* event)
+{
+    return DefaultSimulatorImpl::Schedule(delay, Wrap(event));
+}
+
+void
+MonteCarloProfiler::ScheduleWithContext(uint32_t context, const Time& delay, EventImpl* event)
+{
+    DefaultSimulatorImpl::ScheduleWithContext(context, delay, Wrap(event));
+}
+
+EventId
+MonteCarloProfiler::ScheduleNow(EventImpl* event)
+{
+    return DefaultSimulatorImpl::ScheduleNow(Wrap(event));
+}
+
+void
+MonteCarloProfiler::Record(std::type_index category, double seconds)
+{
+    Statistics& entry = statistics[category];
+    entry.count += 1;
+    entry.seconds += seconds;
+    if (phaseSwitchPending)
+    {
+        Flush();
+        currentRound = nextRound;
+        currentPhase = nextPhase;
+        phaseSwitchPending = false;
+    }
+}
+
+EventImpl*
+MonteCarloProfiler::Wrap(EventImpl* event)
+{
+    // The wrapper takes over the reference passed by the caller
+    return new MonteCarloProfiledEvent(event, this);
+}
+
+const std::string&
+MonteCarloProfiler::GetCategoryName(std::type_index category)
+{
+    auto it = categoryNames.find(category);
+    if (it == categoryNames.end())
+    {
+        int status = 0;
+        char* demangled = abi::__cxa_demangle(category.name(), nullptr, nullptr, &status);
+        std::string name = (status == 0) ? demangled : category.name();
+        std::free(demangled);
+        it = categoryNames.emplace(category, name).first;
+    }
+    return it->second;
+}
+
+}
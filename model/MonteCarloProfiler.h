@@ -0,0 +1,136 @@
+/*
+ * Copyright (c) 2023 AGH University of Science and Technology
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#ifndef MONTECARLOPROFILER_H
+#define MONTECARLOPROFILER_H
+
+#include "ns3/default-simulator-impl.h"
+
+#include <fstream>
+#include <typeindex>
+#include <unordered_map>
+
+namespace ns3
+{
+/**
+ * \ingroup MonteCarloSimulator
+ *
+ * Simulator implementation counting and timing executed events by their category, i.e. the
+ * dynamic type of the scheduled EventImpl. For events created by Simulator::Schedule with a
+ * member function this type is determined by the class and the signature of the method, not
+ * by the method itself: e.g. all void (OnOffApplication::*)() events (StartSending,
+ * StopSending, SendPacket) share one category, and all events scheduled from std::function or
+ * lambdas share another. The invoked method is not reachable from the simulator
+ * implementation, as Simulator::Schedule stores it inside the event before passing it on.
+ * Statistics are aggregated per round and per warmup/measurement phase and written to a .csv
+ * file; once MonteCarloSimulator::EnableProfiling is called, phases are switched by the round
+ * events of the simulator, so that the end of a round is counted in its measurement phase
+ */
+class MonteCarloProfiler : public DefaultSimulatorImpl
+{
+  public:
+    /**
+     * Phase of a round in which the events are executed
+     */
+    enum Phase
+    {
+        WARMUP,
+        MEASUREMENT
+    };
+
+    /**
+     * Register this type.
+     * @return The object TypeId.
+     */
+    static TypeId GetTypeId();
+
+    MonteCarloProfiler();
+    ~MonteCarloProfiler() override;
+
+    /**
+     * Select this simulator implementation; must be called before any event is scheduled or
+     * any node is created, i.e. at the beginning of the simulation script
+     */
+    static void Install();
+
+    /**
+     * Open the output .csv file for the profiling results
+     * @param filename name of the output file
+     */
+    void SetOutputFile(const std::string& filename);
+    /**
+     * Write the statistics of the current phase and start collecting statistics of a new one;
+     * called from an executing event, the phase is switched once that event is recorded, so
+     * that the event is counted in the phase it ends
+     * @param round number of the new round
+     * @param phase the new phase
+     */
+    void SetPhase(uint32_t round, Phase phase);
+    /**
+     * Write the statistics of the current phase to the output file
+     */
+    void Flush();
+
+    void Destroy() override;
+    EventId Schedule(const Time& delay, EventImpl* event) override;
+    void ScheduleWithContext(uint32_t context, const Time& delay, EventImpl* event) override;
+    EventId ScheduleNow(EventImpl* event) override;
+
+    /**
+     * Record the execution of an event
+     * @param category the type of the executed event
+     * @param seconds wall-clock duration of the event
+     */
+    void Record(std::type_index category, double seconds);
+
+  private:
+    /**
+     * Number of executed events and their total wall-clock duration
+     */
+    struct Statistics
+    {
+        uint64_t count = 0;
+        double seconds = 0;
+    };
+
+    /**
+     * Wrap the event so that its execution is recorded
+     * @param event the event to wrap
+     * @return the wrapping event
+     */
+    EventImpl* Wrap(EventImpl* event);
+    /**
+     * Return the demangled name of the event category
+     * @param category the type of the event
+     * @return the demangled name
+     */
+    const std::string& GetCategoryName(std::type_index category);
+
+    uint32_t currentRound = 0;
+    Phase currentPhase = WARMUP;
+    bool phaseSwitchPending = false;
+    uint32_t nextRound = 0;
+    Phase nextPhase = WARMUP;
+    std::unordered_map<std::type_index, Statistics> statistics;
+    std::unordered_map<std::type_index, std::string> categoryNames;
+    std::ofstream outputFile;
+};
+
+}
+
+#endif /* MONTECARLOPROFILER_H */
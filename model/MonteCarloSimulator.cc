@@ -1,10 +1,11 @@
 #include "MonteCarloSimulator.h"
 
-#include "ns3/packet-sink.h"
+#include "ns3/abort.h"
 #include "ns3/log.h"
 #include "ns3/names.h"
 #include "ns3/simulator.h"
 #include "functional"
+#include "iostream"
 
 namespace ns3
 {
@@ -20,130 +21,148 @@ MonteCarloSimulator::MonteCarloSimulator(ApplicationContainer* sinkApplications,
                                          bool useDefaultRewardCalculation,
                                          std::function<void()> BehaviourFunction)
 {
-    sinks = sinkApplications;
     rounds = numberOfRounds;
     time = roundTime;
     warmup = roundWarmup;
-    outputFileName = outputName + ".csv";
+    outputBaseName = outputName;
     printing = resultsPrinting;
     useDefaultCalculation = useDefaultRewardCalculation;
-    if (useDefaultRewardCalculation)
+    behaviourFunction = BehaviourFunction;
+    NS_ABORT_MSG_IF(rounds >= MAX_ROUNDS,
+                    "Number of rounds must be lower than " << MAX_ROUNDS);
+
+    // Per-flow arrays are value-initialized (zeroed) and sized by the number of sinks
+    throughputArray = std::make_unique<double[][MAX_ROUNDS]>(sinkApplications->GetN());
+    rewardArray = std::make_unique<double[][MAX_ROUNDS]>(sinkApplications->GetN());
+    totalBytes = std::make_unique<u_int32_t[]>(sinkApplications->GetN());
+    engine = std::make_unique<Engine>(DynamicCollector{this, PacketSinkCollector(sinkApplications)},
+                                      DynamicRewardPolicy{this, RunningMeanReward()},
+                                      DynamicWriter{this, CsvRewardWriter(outputName), {}},
+                                      static_cast<uint32_t>(rounds),
+                                      time,
+                                      warmup,
+                                      DynamicBehaviour{this});
+}
+
+void
+MonteCarloSimulator::DynamicCollector::Connect()
+{
+    if (simulator->useDefaultCalculation)
     {
-        Simulator::Schedule(Seconds(warmup),
-                            &MonteCarloSimulator::GetWarmupStatistics,this);
+        sinkCollector.Connect();
     }
-    for (int round = 0; round < rounds + 1; ++round)
+}
+
+void
+MonteCarloSimulator::DynamicCollector::Checkpoint()
+{
+    if (simulator->profiler)
     {
-        if (useDefaultRewardCalculation){
-            Simulator::Schedule(Seconds((round + 1) * time),
-                                &MonteCarloSimulator::DefaultRewardCalculation, this);
-            Simulator::Schedule(Seconds((round + 1) * time + warmup),
-                                &MonteCarloSimulator::GetWarmupStatistics, this);
-            Simulator::Schedule(Seconds((round + 1) * time),
-                                &MonteCarloSimulator::HandleResults, this);
-        }
-        Simulator::Schedule(Seconds((round + 1) * time),
-                            BehaviourFunction);
+        simulator->profiler->SetPhase(simulator->engine->GetCurrentRound(),
+                                      MonteCarloProfiler::MEASUREMENT);
     }
-    for (int i = 0; i < 200; ++i)
+    if (simulator->useDefaultCalculation)
     {
-        for (int j = 0; j < 500; ++j)
-        {
-            throughputArray[i][j] = 0;
-            throughputSumArray[i] = 0;
-            totalBytes[i] = 0;
-            chooseArray[i] = 0;
-            rewardArray[i][j] = 0;
-        }
+        sinkCollector.Checkpoint([this](uint32_t flow, uint64_t bytes) {
+            simulator->totalBytes[flow] = bytes;
+        });
+    }
+    else if (simulator->warmupStatisticsFunction)
+    {
+        simulator->warmupStatisticsFunction();
     }
 }
 
-bool
-MonteCarloSimulator::FileExists(const std::string& filename)
+void
+MonteCarloSimulator::DynamicRewardPolicy::Update(uint32_t flow, double throughput)
 {
-    std::ifstream f(filename.c_str());
-    return f.good();
+    simulator->throughputArray[flow][simulator->currentRound] = throughput;
+    runningMean.Update(flow, throughput);
 }
 
 void
-MonteCarloSimulator::GetWarmupStatistics()
+MonteCarloSimulator::DynamicRewardPolicy::EndRound()
 {
-    for (uint32_t applicationIndex = 0; applicationIndex < sinks->GetN(); ++applicationIndex)
+    if (simulator->useDefaultCalculation)
+    {
+        return;
+    }
+    // With custom hooks the behaviour sees the finished round before its rewards are calculated
+    if (simulator->behaviourFunction)
     {
-        totalBytes[applicationIndex] =
-            DynamicCast<PacketSink>(sinks->Get(applicationIndex))->GetTotalRx();
+        simulator->behaviourFunction();
     }
+    if (simulator->rewardCalculationFunction)
+    {
+        simulator->rewardCalculationFunction();
+    }
+}
+
+void
+MonteCarloSimulator::DynamicWriter::Open(uint32_t flows)
+{
+    csvWriter.Open(flows);
+    customRewards.resize(flows);
 }
 
 void
-MonteCarloSimulator::DefaultRewardCalculation()
+MonteCarloSimulator::DynamicWriter::Write(uint32_t round, const std::vector<double>& rewards)
 {
-    uint64_t totalBytesThroughput[sinks->GetN()];
-    for (uint32_t applicationIndex = 0; applicationIndex < sinks->GetN(); ++applicationIndex)
+    auto rewardArray = simulator->rewardArray.get();
+    if (simulator->useDefaultCalculation)
     {
-        totalBytesThroughput[applicationIndex] =
-            DynamicCast<PacketSink>(sinks->Get(applicationIndex))->GetTotalRx();
-        throughputArray[applicationIndex][currentRound] =
-            (totalBytesThroughput[applicationIndex] - totalBytes[applicationIndex]) * 8 /
-            ((time - warmup) * 1000000.0);
-        totalBytes[applicationIndex] = totalBytesThroughput[applicationIndex];
+        // Idle flows carry their previous reward forward
+        for (uint32_t applicationIndex = 0; applicationIndex < rewards.size(); ++applicationIndex)
+        {
+            rewardArray[applicationIndex][round] = rewards[applicationIndex];
+        }
+        csvWriter.Write(round, rewards);
     }
-    for (uint32_t applicationIndex = 0; applicationIndex < sinks->GetN(); ++applicationIndex)
+    else if (simulator->rewardCalculationFunction)
     {
-        if (throughputArray[applicationIndex][currentRound] > 0)
+        // Custom reward calculation stores the rewards in rewardArray
+        for (uint32_t applicationIndex = 0; applicationIndex < customRewards.size();
+             ++applicationIndex)
         {
-            chooseArray[applicationIndex] += 1;
-            throughputSumArray[applicationIndex] += throughputArray[applicationIndex][currentRound];
-            rewardArray[applicationIndex][currentRound] =
-                throughputSumArray[applicationIndex] / chooseArray[applicationIndex];
+            customRewards[applicationIndex] = rewardArray[applicationIndex][round];
         }
+        csvWriter.Write(round, customRewards);
+    }
+    else
+    {
+        // Without the reward calculation function no results are stored
+        return;
     }
-}
 
-void
-MonteCarloSimulator::HandleResults()
-{
-    if (currentRound >= printing)
+    if (static_cast<int>(round) >= simulator->printing)
     {
-        std::cout << "Results for round " << currentRound << ": " << std::endl;
-        for (uint32_t applicationIndex = 0; applicationIndex < sinks->GetN();
+        std::cout << "Results for round " << round << ": " << std::endl;
+        for (uint32_t applicationIndex = 0; applicationIndex < customRewards.size();
              ++applicationIndex)
         {
             std::cout << "Reward for application number " << applicationIndex << ": "
-                      << rewardArray[applicationIndex][currentRound] << std::endl;
+                      << rewardArray[applicationIndex][round] << std::endl;
         }
     }
-    std::ofstream outputFile;
+    simulator->currentRound = round + 1;
+}
 
-    std::string outputCsv = outputFileName;
-    if (FileExists(outputCsv))
+void
+MonteCarloSimulator::DynamicBehaviour::operator()(uint32_t round,
+                                                  const DynamicRewardPolicy& rewardPolicy)
+{
+    if (simulator->useDefaultCalculation && simulator->behaviourFunction)
     {
-        // If the file exists, append to it
-        outputFile.open(outputCsv, std::ios::app);
+        simulator->behaviourFunction();
     }
-    else
+    if (simulator->profiler)
     {
-        // If the file does not exist, create it and set the header line
-        outputFile.open(outputCsv, std::ios::app);
-        outputFile << "StageNumber";
-        for (uint32_t applicationIndex = 0; applicationIndex < sinks->GetN();
-             ++applicationIndex)
-        {
-            outputFile << ",Reward" << applicationIndex;
-        }
-        outputFile << std::endl;
+        simulator->profiler->SetPhase(round + 1, MonteCarloProfiler::WARMUP);
     }
-
-    outputFile << currentRound;
-    for (uint32_t applicationIndex = 0; applicationIndex < sinks->GetN();
-         ++applicationIndex)
+    if (simulator->endConditionFunction && simulator->endConditionFunction())
     {
-        outputFile << "," << rewardArray[applicationIndex][currentRound];
+        Simulator::Stop();
     }
-    outputFile << std::endl;
-
-    outputFile.close();
-    currentRound += 1;
 }
 
 int*
@@ -152,29 +171,29 @@ MonteCarloSimulator::GetCurrentRound()
     return &currentRound;
 }
 
-double (*MonteCarloSimulator::GetRewardArray())[500]
+double (*MonteCarloSimulator::GetRewardArray())[MAX_ROUNDS]
 {
-    return rewardArray;
+    return rewardArray.get();
 }
 
 double *MonteCarloSimulator::GetChooseArray()
 {
-    return chooseArray;
+    return engine->GetRewardPolicy().runningMean.GetChooseArray();
 }
 
 u_int32_t *MonteCarloSimulator::GetTotalBytes()
 {
-    return totalBytes;
+    return totalBytes.get();
 }
 
-double (*MonteCarloSimulator::GetThroughputArray())[500]
+double (*MonteCarloSimulator::GetThroughputArray())[MAX_ROUNDS]
 {
-    return throughputArray;
+    return throughputArray.get();
 }
 
 double *MonteCarloSimulator::GetThroughputSumArray()
 {
-    return throughputSumArray;
+    return engine->GetRewardPolicy().runningMean.GetThroughputSumArray();
 }
 
 void
@@ -182,13 +201,7 @@ MonteCarloSimulator::SetRewardCalculationFunction(std::function<void()> RewardCa
 {
     if (!useDefaultCalculation)
     {
-        for (int round = 0; round < rounds + 1; ++round)
-        {
-            Simulator::Schedule(Seconds((round + 1) * time), RewardCalculationFunction);
-            Simulator::Schedule(Seconds((round + 1) * time),
-                                &MonteCarloSimulator::HandleResults,
-                                this);
-        }
+        rewardCalculationFunction = RewardCalculationFunction;
     }
 }
 
@@ -198,24 +211,23 @@ MonteCarloSimulator::SetWarmupStatisticsCollectionFunction(
 {
     if (!useDefaultCalculation)
     {
-        for (int round = 0; round < rounds + 2; ++round)
-        {
-            Simulator::Schedule(Seconds((round)*time + warmup), WarmupStatisticsFunction);
-        }
+        warmupStatisticsFunction = WarmupStatisticsFunction;
     }
 }
 
 void
 MonteCarloSimulator::SetEndConditionFunction(std::function<bool()> EndConditionFunction)
 {
-    for (int round = 0; round < rounds + 1; ++round)
-    {
-        Simulator::Schedule(Seconds((round + 1) * time), [EndConditionFunction]()
-                            {if (EndConditionFunction()){
-                Simulator::Stop();
-            }});
-    }
+    endConditionFunction = EndConditionFunction;
 }
 
+void
+MonteCarloSimulator::EnableProfiling()
+{
+    profiler = DynamicCast<MonteCarloProfiler>(Simulator::GetImplementation());
+    NS_ABORT_MSG_IF(!profiler,
+                    "MonteCarloProfiler::Install() must be called before any event is scheduled");
+    profiler->SetOutputFile(outputBaseName + "-profile.csv");
+}
 
-}
\ No newline at end of file
+}
@@ -25,36 +25,51 @@
  * \defgroup MonteCarloSimulator Description of the MonteCarloSimulator
  */
 
+#include "MonteCarloProfiler.h"
+#include "MonteCarloSimulatorT.h"
+
 #include "ns3/application-container.h"
 
+#include <functional>
+#include <memory>
+#include <vector>
+
 namespace ns3
 {
 /**
  * This object implements the Monte Carlo simulator object, capable of conducting Monte Carlo
- * simulations
+ * simulations. It is the dynamic instantiation of MonteCarloSimulatorT: its collector, reward
+ * policy, writer and behaviour forward to the PacketSink collector, the running mean reward
+ * and the .csv writer, or to the std::function hooks set at run time
  */
 class MonteCarloSimulator
 {
   public:
+    /**
+     * Number of rounds stored in the per-round throughput and reward arrays
+     */
+    static constexpr uint32_t MAX_ROUNDS = 500;
+
     /**
      * The constructor of the MonteCarloSimulator library. This method copies a reference to
      * ApplicationContainer with sinkApplications and schedules appropriate number of rounds,
-     * based on the provided arguments
+     * based on the provided arguments; per-flow arrays are sized from the number of sinks, so
+     * all sink applications must be installed before the simulator is created
      * @param sinkApplications a reference to ApplicationContainer with Application Sinks,
      * which are used in default per-flow reward calculation
      * @param numberOfRounds number of scheduled rounds (starting from round 1; simulator allows
      * the user to run "zero round" with the desired pre-conditions (configured outside this
      * simulator). The MonteCarloSimulator will gather statistics from that round, but scheduling
-     * occurs from round 1 to round number numberOfRounds
+     * occurs from round 1 to round number numberOfRounds; must be lower than MAX_ROUNDS
      * @param roundTime time of a single round
      * @param roundWarmup time of the warmup period (period from which statistics are not included
      * in reward calculation)
      * @param outputName name for the output .csv file with per-flow rewards from each round;
      * the reward from each round is a average throughput obtained during rounds in which the flow
-     * was active (its throughput was higher then 0)
+     * was active (its throughput was higher then 0); idle flows keep their previous reward
      * @param resultsPrinting number of the first round from which results are printed in the
      * console; creation of output file is enabled from round 0
-     * @param useDefaultRewardCalculation boolean value used for either scheduling the default
+     * @param useDefaultRewardCalculation boolean value used for either using the default
      * warmup statistics collector and reward calculator or to set these methods later using
      * separate methods
      * @param BehaviourFunction function with the behaviour of nodes in the network; this function
@@ -64,6 +79,11 @@ class MonteCarloSimulator
                         double roundTime, double roundWarmup, std::string outputName,
                         uint32_t resultsPrinting, bool useDefaultRewardCalculation,
                         std::function<void()> BehaviourFunction);
+
+    // The scheduled events refer to this object
+    MonteCarloSimulator(const MonteCarloSimulator&) = delete;
+    MonteCarloSimulator& operator=(const MonteCarloSimulator&) = delete;
+
     /**
      * Return the pointer to integer with current round number
      * @return the pointer to integer with current round number
@@ -87,7 +107,7 @@ class MonteCarloSimulator
      * first is the number of flow and the second is number of the round
      * @return the pointer to the array with throughputs obtained by each flow in consecutive rounds
      */
-    double (*GetThroughputArray())[500];
+    double (*GetThroughputArray())[MAX_ROUNDS];
     /**
      * Return the array with sum of the throughputs obtained by each flow in consecutive rounds;
      * first index is the number of flow and the second is number of the round
@@ -100,7 +120,7 @@ class MonteCarloSimulator
      * first index is the number of flow and the second is number of the round
      * @return the pointer to the array with per-flow rewards obtained in consecutive rounds
      */
-    double (*GetRewardArray())[500];
+    double (*GetRewardArray())[MAX_ROUNDS];
     /**
      * Set the custom reward calculation function; this method should be of void() type, take
      * no input parameters and store the values of the rewards in rewardArray
@@ -121,43 +141,113 @@ class MonteCarloSimulator
      * returning true value ends whole simulation, regardless of the number of remaining rounds
      */
     void SetEndConditionFunction(std::function<bool()> EndConditionFunction);
+    /**
+     * Enable the per-event-category profiler; events executed in each warmup and measurement
+     * period are counted and timed per category (the class and signature of the invoked
+     * method, see MonteCarloProfiler) and stored in outputName-profile.csv next to the results.
+     * Requires MonteCarloProfiler::Install() to be called before any event is scheduled
+     */
+    void EnableProfiling();
 
   private:
-    ApplicationContainer* sinks;
-    double rounds;
-    double time;
-    double warmup;
-    int printing;
-    std::string outputFileName;
-    double chooseArray[200];
-    uint32_t totalBytes[200];
-    double throughputArray[200][500];
-    double throughputSumArray[200];
-    double rewardArray[200][500];
-    int currentRound = 0;
-    bool useDefaultCalculation;
-    /*
-     * Function gathering the total number of bytes transmitted before the warm-up period after
-     * the "warmup" time; the previous periods are not included during reward calculation
+    /**
+     * Collector forwarding to the PacketSink collector with the default reward calculation or
+     * to the custom warmup statistics function
      */
-    void GetWarmupStatistics();
+    struct DynamicCollector
+    {
+        MonteCarloSimulator* simulator;
+        PacketSinkCollector sinkCollector;
+
+        uint32_t GetN() const
+        {
+            return sinkCollector.GetN();
+        }
+        void Connect();
+        void Checkpoint();
+        template <typename Update>
+        void Collect(double seconds, Update&& update)
+        {
+            if (simulator->useDefaultCalculation)
+            {
+                sinkCollector.Collect(seconds, [this, &update](uint32_t flow, double throughput) {
+                    simulator->totalBytes[flow] = sinkCollector.GetTotalBytes()[flow];
+                    update(flow, throughput);
+                });
+            }
+        }
+    };
+
     /**
-     * Results handler; by default this function stores all results in filename.csv and prints
-     * the results in the console starting from the "printing" round
+     * Reward policy forwarding to the running mean reward, which also fills the per-round
+     * throughput array, or to the behaviour function followed by the custom reward calculation
+     * function, so that with custom hooks the behaviour still sees the number of the finished
+     * round
      */
-    void HandleResults();
-    /*
-     * Function with the default reward calculation method: average throughput granted to a flow
-     * in a rounds when the flow was active (its throughput was higher than 0)
+    struct DynamicRewardPolicy
+    {
+        MonteCarloSimulator* simulator;
+        RunningMeanReward runningMean;
+
+        void Resize(uint32_t flows)
+        {
+            runningMean.Resize(flows);
+        }
+        void Update(uint32_t flow, double throughput);
+        void EndRound();
+        const std::vector<double>& GetRewards() const
+        {
+            return runningMean.GetRewards();
+        }
+    };
+
+    /**
+     * Writer storing the rewards of the round in rewardArray and in the .csv file, printing
+     * them in the console starting from the "printing" round and advancing the current round;
+     * with custom hooks the results are stored only once the reward calculation function is set
      */
-    void DefaultRewardCalculation();
+    struct DynamicWriter
+    {
+        MonteCarloSimulator* simulator;
+        CsvRewardWriter csvWriter;
+        std::vector<double> customRewards;
+
+        void Open(uint32_t flows);
+        void Write(uint32_t round, const std::vector<double>& rewards);
+    };
+
     /**
-     * Function to check whether the file with the filename name exists in the output location;
-     * of the file exists the results are added to the bottom of the file
-     * @param filename name of the .csv file (passed without the ".csv") to be checked
-     * @return true if the file exists or false in the other case
+     * Behaviour invoking the behaviour function with the default reward calculation and the end
+     * condition function
      */
-    bool FileExists(const std::string& filename);
+    struct DynamicBehaviour
+    {
+        MonteCarloSimulator* simulator;
+
+        void operator()(uint32_t round, const DynamicRewardPolicy& rewardPolicy);
+    };
+
+    using Engine = MonteCarloSimulatorT<DynamicCollector,
+                                        DynamicRewardPolicy,
+                                        DynamicWriter,
+                                        DynamicBehaviour>;
+
+    double rounds;
+    double time;
+    double warmup;
+    int printing;
+    std::string outputBaseName;
+    std::unique_ptr<double[][MAX_ROUNDS]> throughputArray;
+    std::unique_ptr<double[][MAX_ROUNDS]> rewardArray;
+    std::unique_ptr<u_int32_t[]> totalBytes;
+    int currentRound = 0;
+    bool useDefaultCalculation;
+    std::function<void()> behaviourFunction;
+    std::function<void()> rewardCalculationFunction;
+    std::function<void()> warmupStatisticsFunction;
+    std::function<bool()> endConditionFunction;
+    std::unique_ptr<Engine> engine;
+    Ptr<MonteCarloProfiler> profiler;
 };
 
 }
@@ -0,0 +1,68 @@
+#include "MonteCarloSimulatorT.h"
+
+#include "ns3/abort.h"
+#include "ns3/callback.h"
+
+namespace ns3
+{
+
+PacketSinkCollector::PacketSinkCollector(ApplicationContainer* sinkApplications)
+{
+    sinks.resize(sinkApplications->GetN());
+    for (uint32_t applicationIndex = 0; applicationIndex < sinks.size(); ++applicationIndex)
+    {
+        sinks[applicationIndex] = DynamicCast<PacketSink>(sinkApplications->Get(applicationIndex));
+    }
+    totalBytes.assign(sinks.size(), 0);
+    activeFlag.assign(sinks.size(), false);
+    activeFlows.reserve(sinks.size());
+}
+
+void
+PacketSinkCollector::Connect()
+{
+    for (uint32_t flow = 0; flow < sinks.size(); ++flow)
+    {
+        NS_ABORT_MSG_IF(!sinks[flow], "Application " << flow << " is not a PacketSink");
+        sinks[flow]->TraceConnectWithoutContext(
+            "Rx",
+            MakeBoundCallback(&PacketSinkCollector::FlowReceived, this, flow));
+    }
+}
+
+void
+PacketSinkCollector::FlowReceived(PacketSinkCollector* collector,
+                                  uint32_t flow,
+                                  Ptr<const Packet> packet,
+                                  const Address& address)
+{
+    if (!collector->activeFlag[flow])
+    {
+        collector->activeFlag[flow] = true;
+        collector->activeFlows.push_back(flow);
+    }
+}
+
+CsvRewardWriter::CsvRewardWriter(std::string outputName)
+{
+    outputFileName = outputName + ".csv";
+}
+
+void
+CsvRewardWriter::Open(uint32_t flows)
+{
+    bool exists = std::ifstream(outputFileName).good();
+    outputFile.open(outputFileName, std::ios::app);
+    if (!exists)
+    {
+        // If the file does not exist, set the header line
+        outputFile << "StageNumber";
+        for (uint32_t applicationIndex = 0; applicationIndex < flows; ++applicationIndex)
+        {
+            outputFile << ",Reward" << applicationIndex;
+        }
+        outputFile << std::endl;
+    }
+}
+
+}
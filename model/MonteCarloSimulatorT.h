@@ -0,0 +1,591 @@
+/*
+ * Copyright (c) 2023 AGH University of Science and Technology
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+
+#ifndef MONTECARLOSIMULATORT_H
+#define MONTECARLOSIMULATORT_H
+
+#include "ns3/abort.h"
+#include "ns3/application-container.h"
+#include "ns3/packet-sink.h"
+#include "ns3/simulator.h"
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <limits>
+#include <vector>
+
+namespace ns3
+{
+/**
+ * \ingroup MonteCarloSimulator
+ *
+ * Collector of per-flow throughput from PacketSink applications. Typed sinks are resolved once
+ * and only the flows which received data since the last checkpoint, tracked through the sink
+ * Rx traces, are read
+ */
+class PacketSinkCollector
+{
+  public:
+    /**
+     * The constructor of the collector
+     * @param sinkApplications a reference to ApplicationContainer with PacketSink applications
+     */
+    explicit PacketSinkCollector(ApplicationContainer* sinkApplications);
+    /**
+     * Return the number of flows
+     * @return the number of flows
+     */
+    uint32_t GetN() const
+    {
+        return sinks.size();
+    }
+    /**
+     * Connect to the Rx traces of the sinks; called by the simulator once the collector is
+     * stored at its final location. All applications must be PacketSinks
+     */
+    void Connect();
+    /**
+     * Return the pointer to per-flow number of bytes received until the last checkpoint; flows
+     * which did not receive data since then hold their current number of received bytes
+     * @return the pointer to per-flow number of received bytes
+     */
+    uint64_t* GetTotalBytes()
+    {
+        return totalBytes.data();
+    }
+    /**
+     * Store the number of received bytes of active flows at the end of the warmup
+     */
+    void Checkpoint()
+    {
+        Checkpoint([](uint32_t flow, uint64_t bytes) {});
+    }
+    /**
+     * Store the number of received bytes of active flows at the end of the warmup
+     * @param stored function called with the flow index and its stored number of bytes
+     */
+    template <typename Stored>
+    void Checkpoint(Stored&& stored)
+    {
+        for (uint32_t flow : activeFlows)
+        {
+            totalBytes[flow] = sinks[flow]->GetTotalRx();
+            activeFlag[flow] = false;
+            stored(flow, totalBytes[flow]);
+        }
+        activeFlows.clear();
+    }
+    /**
+     * Pass the throughput in Mb/s of every flow which received data since the checkpoint
+     * @param seconds duration of the measurement period
+     * @param update function called with the flow index and its throughput
+     */
+    template <typename Update>
+    void Collect(double seconds, Update&& update)
+    {
+        for (uint32_t flow : activeFlows)
+        {
+            uint64_t bytes = sinks[flow]->GetTotalRx();
+            double throughput = (bytes - totalBytes[flow]) * 8 / (seconds * 1000000.0);
+            totalBytes[flow] = bytes;
+            activeFlag[flow] = false;
+            update(flow, throughput);
+        }
+        activeFlows.clear();
+    }
+
+  private:
+    /**
+     * Packet sink Rx trace sink marking the flow as active
+     * @param collector the collector tracking the flow
+     * @param flow index of the flow
+     * @param packet the received packet
+     * @param address the address of the sender
+     */
+    static void FlowReceived(PacketSinkCollector* collector, uint32_t flow,
+                             Ptr<const Packet> packet, const Address& address);
+
+    std::vector<Ptr<PacketSink>> sinks;
+    std::vector<uint64_t> totalBytes;
+    std::vector<bool> activeFlag;
+    std::vector<uint32_t> activeFlows;
+};
+
+/**
+ * \ingroup MonteCarloSimulator
+ *
+ * Storage of per-flow rewards shared by the reward policies
+ */
+class RewardPolicyBase
+{
+  public:
+    /**
+     * Set the number of flows
+     * @param flows the number of flows
+     */
+    void Resize(uint32_t flows)
+    {
+        rewards.assign(flows, 0);
+    }
+    /**
+     * Return the current reward of the flow
+     * @param flow index of the flow
+     * @return the current reward of the flow
+     */
+    double GetReward(uint32_t flow) const
+    {
+        return rewards[flow];
+    }
+    /**
+     * Return the current rewards of all flows; idle flows keep their previous reward
+     * @return the current rewards of all flows
+     */
+    const std::vector<double>& GetRewards() const
+    {
+        return rewards;
+    }
+    /**
+     * Called after all active flows of the round were updated
+     */
+    void EndRound()
+    {
+    }
+
+  protected:
+    std::vector<double> rewards;
+};
+
+/**
+ * \ingroup MonteCarloSimulator
+ *
+ * Average throughput obtained in the rounds in which the flow was active; the default reward
+ * of MonteCarloSimulator
+ */
+class RunningMeanReward : public RewardPolicyBase
+{
+  public:
+    void Resize(uint32_t flows)
+    {
+        RewardPolicyBase::Resize(flows);
+        chooseCount.assign(flows, 0);
+        throughputSum.assign(flows, 0);
+    }
+    /**
+     * Update the reward of an active flow
+     * @param flow index of the flow
+     * @param throughput throughput of the flow in the round
+     */
+    void Update(uint32_t flow, double throughput)
+    {
+        chooseCount[flow] += 1;
+        throughputSum[flow] += throughput;
+        rewards[flow] = throughputSum[flow] / chooseCount[flow];
+    }
+    /**
+     * Return the pointer to array with the number of rounds in which the flow was active
+     * @return the pointer to array with the number of rounds in which the flow was active
+     */
+    double* GetChooseArray()
+    {
+        return chooseCount.data();
+    }
+    /**
+     * Return the pointer to array with the sum of throughputs of the flow in active rounds
+     * @return the pointer to array with the sum of throughputs of the flow in active rounds
+     */
+    double* GetThroughputSumArray()
+    {
+        return throughputSum.data();
+    }
+
+  private:
+    std::vector<double> chooseCount;
+    std::vector<double> throughputSum;
+};
+
+/**
+ * \ingroup MonteCarloSimulator
+ *
+ * Exponentially weighted moving average of the throughput in the rounds in which the flow was
+ * active; the first active round sets the reward to its throughput
+ */
+class EwmaReward : public RewardPolicyBase
+{
+  public:
+    /**
+     * The constructor of the policy
+     * @param smoothing weight of the latest throughput, in range (0, 1]
+     */
+    explicit EwmaReward(double smoothing)
+        : alpha(smoothing)
+    {
+        NS_ABORT_MSG_IF(alpha <= 0 || alpha > 1, "EWMA weight must be within (0, 1]");
+    }
+    void Resize(uint32_t flows)
+    {
+        RewardPolicyBase::Resize(flows);
+        chosen.assign(flows, false);
+    }
+    void Update(uint32_t flow, double throughput)
+    {
+        rewards[flow] = chosen[flow] ? alpha * throughput + (1 - alpha) * rewards[flow]
+                                     : throughput;
+        chosen[flow] = true;
+    }
+
+  private:
+    double alpha;
+    std::vector<bool> chosen;
+};
+
+/**
+ * \ingroup MonteCarloSimulator
+ *
+ * Average throughput of the last window rounds in which the flow was active
+ */
+class SlidingWindowReward : public RewardPolicyBase
+{
+  public:
+    /**
+     * The constructor of the policy
+     * @param windowSize number of active rounds included in the average; must be positive
+     */
+    explicit SlidingWindowReward(uint32_t windowSize)
+        : window(windowSize)
+    {
+        NS_ABORT_MSG_IF(window == 0, "Window of the sliding window reward must be positive");
+    }
+    void Resize(uint32_t flows)
+    {
+        RewardPolicyBase::Resize(flows);
+        samples.assign(static_cast<size_t>(flows) * window, 0);
+        sampleCount.assign(flows, 0);
+        sampleSum.assign(flows, 0);
+    }
+    void Update(uint32_t flow, double throughput)
+    {
+        // Samples of a flow form a ring buffer of window entries
+        double& sample = samples[static_cast<size_t>(flow) * window + sampleCount[flow] % window];
+        if (sampleCount[flow] >= window)
+        {
+            sampleSum[flow] -= sample;
+        }
+        sample = throughput;
+        sampleSum[flow] += throughput;
+        sampleCount[flow] += 1;
+        rewards[flow] = sampleSum[flow] / std::min(sampleCount[flow], window);
+    }
+
+  private:
+    uint32_t window;
+    std::vector<double> samples;
+    std::vector<uint32_t> sampleCount;
+    std::vector<double> sampleSum;
+};
+
+/**
+ * \ingroup MonteCarloSimulator
+ *
+ * Network-wide utility of the round, computed over the throughputs of all active flows and
+ * averaged for each flow over the rounds in which it was active. The utilities are
+ * non-negative and do not depend on the number of active flows, so that rounds are
+ * comparable; flows which were never active keep the reward 0, the lowest possible one
+ */
+template <typename Utility>
+class FairnessReward : public RewardPolicyBase
+{
+  public:
+    void Resize(uint32_t flows)
+    {
+        RewardPolicyBase::Resize(flows);
+        chooseCount.assign(flows, 0);
+        utilitySum.assign(flows, 0);
+        activeFlows.reserve(flows);
+    }
+    void Update(uint32_t flow, double throughput)
+    {
+        activeFlows.push_back(flow);
+        utility = activeFlows.size() == 1 ? Utility::Apply(throughput)
+                                          : Utility::Combine(utility, throughput);
+    }
+    void EndRound()
+    {
+        utility = Utility::Normalize(utility, activeFlows.size());
+        for (uint32_t flow : activeFlows)
+        {
+            chooseCount[flow] += 1;
+            utilitySum[flow] += utility;
+            rewards[flow] = utilitySum[flow] / chooseCount[flow];
+        }
+        activeFlows.clear();
+    }
+
+  private:
+    double utility = 0;
+    std::vector<uint32_t> activeFlows;
+    std::vector<double> chooseCount;
+    std::vector<double> utilitySum;
+};
+
+/**
+ * Max-min fairness utility: the lowest throughput of the active flows, in Mb/s
+ */
+struct MaxMinUtility
+{
+    static double Apply(double throughput)
+    {
+        return throughput;
+    }
+    static double Combine(double utility, double throughput)
+    {
+        return std::min(utility, throughput);
+    }
+    static double Normalize(double utility, size_t flows)
+    {
+        return utility;
+    }
+};
+
+/**
+ * Proportional fairness utility: the mean of log(1 + throughput in Mb/s) over the active
+ * flows; the offset keeps the utility non-negative for flows below 1 Mb/s
+ */
+struct ProportionalUtility
+{
+    static double Apply(double throughput)
+    {
+        return std::log1p(throughput);
+    }
+    static double Combine(double utility, double throughput)
+    {
+        return utility + std::log1p(throughput);
+    }
+    static double Normalize(double utility, size_t flows)
+    {
+        return utility / flows;
+    }
+};
+
+using MaxMinFairnessReward = FairnessReward<MaxMinUtility>;
+using ProportionalFairnessReward = FairnessReward<ProportionalUtility>;
+
+/**
+ * \ingroup MonteCarloSimulator
+ *
+ * Writer storing per-flow rewards from each round in a .csv file, in the format used by
+ * MonteCarloSimulator; if the file exists the results are added to the bottom of the file
+ */
+class CsvRewardWriter
+{
+  public:
+    /**
+     * The constructor of the writer
+     * @param outputName name for the output .csv file, passed without the ".csv"
+     */
+    explicit CsvRewardWriter(std::string outputName);
+    /**
+     * Open the output file and write the header line if the file is new
+     * @param flows the number of flows
+     */
+    void Open(uint32_t flows);
+    /**
+     * Write the rewards of all flows from the round
+     * @param round number of the round
+     * @param rewards the rewards of all flows
+     */
+    void Write(uint32_t round, const std::vector<double>& rewards)
+    {
+        outputFile << round;
+        for (double reward : rewards)
+        {
+            outputFile << "," << reward;
+        }
+        outputFile << "\n";
+    }
+
+  private:
+    std::string outputFileName;
+    std::ofstream outputFile;
+};
+
+/**
+ * Writer discarding the rewards
+ */
+struct NullRewardWriter
+{
+    void Open(uint32_t flows)
+    {
+    }
+    void Write(uint32_t round, const std::vector<double>& rewards)
+    {
+    }
+};
+
+/**
+ * Behaviour doing nothing between rounds
+ */
+struct NoBehaviour
+{
+    template <typename RewardPolicy>
+    void operator()(uint32_t round, const RewardPolicy& rewardPolicy)
+    {
+    }
+};
+
+/**
+ * \ingroup MonteCarloSimulator
+ *
+ * Monte Carlo simulator with the statistics collector, the reward formula, the output writer
+ * and the behaviour of nodes composed at compile time, so that the per-round hooks are called
+ * directly instead of through std::function. MonteCarloSimulator is the dynamic instantiation
+ * of this template, with components forwarding to std::function hooks set at run time.
+ *
+ * All rounds are scheduled by the constructor as member function events, so that the end of the
+ * last round precedes a Simulator::Stop() scheduled afterwards for the same time. At the end of
+ * each round the collector passes the throughput of the active flows to the reward policy, the
+ * writer stores the rewards of all flows and the behaviour is invoked with the number of the
+ * finished round and the policy; the behaviour may call Simulator::Stop() to end the simulation
+ * early.
+ *
+ * The Collector must provide GetN(), Connect(), Checkpoint() and Collect(seconds, update);
+ * the RewardPolicy Resize(flows), Update(flow, throughput), EndRound() and GetRewards();
+ * the Writer Open(flows) and Write(round, rewards).
+ */
+template <typename Collector,
+          typename RewardPolicy,
+          typename Writer,
+          typename Behaviour = NoBehaviour>
+class MonteCarloSimulatorT
+{
+  public:
+    /**
+     * The constructor of the simulator; schedules the warmup checkpoint and the end of every
+     * round, from round 0 to round numberOfRounds
+     * @param collector the statistics collector
+     * @param rewardPolicy the reward formula
+     * @param writer the output writer
+     * @param numberOfRounds number of rounds after the "zero round", as in MonteCarloSimulator
+     * @param roundTime time of a single round
+     * @param roundWarmup time of the warmup period of each round
+     * @param behaviour the behaviour of nodes invoked after each round
+     */
+    MonteCarloSimulatorT(Collector collector,
+                         RewardPolicy rewardPolicy,
+                         Writer writer,
+                         uint32_t numberOfRounds,
+                         double roundTime,
+                         double roundWarmup,
+                         Behaviour behaviour = Behaviour())
+        : statisticsCollector(std::move(collector)),
+          rewards(std::move(rewardPolicy)),
+          output(std::move(writer)),
+          nodesBehaviour(std::move(behaviour)),
+          rounds(numberOfRounds),
+          time(roundTime),
+          warmup(roundWarmup)
+    {
+        statisticsCollector.Connect();
+        rewards.Resize(statisticsCollector.GetN());
+        output.Open(statisticsCollector.GetN());
+        for (uint32_t round = 0; round < rounds + 1; ++round)
+        {
+            Simulator::Schedule(Seconds(round * time + warmup),
+                                &MonteCarloSimulatorT::Warmup,
+                                this);
+            Simulator::Schedule(Seconds((round + 1) * time),
+                                &MonteCarloSimulatorT::EndRound,
+                                this);
+        }
+    }
+
+    // The scheduled events refer to this object
+    MonteCarloSimulatorT(const MonteCarloSimulatorT&) = delete;
+    MonteCarloSimulatorT& operator=(const MonteCarloSimulatorT&) = delete;
+
+    /**
+     * Return the number of the current round
+     * @return the number of the current round
+     */
+    uint32_t GetCurrentRound() const
+    {
+        return currentRound;
+    }
+    /**
+     * Return the reward policy with the current per-flow rewards
+     * @return the reward policy
+     */
+    const RewardPolicy& GetRewardPolicy() const
+    {
+        return rewards;
+    }
+    /**
+     * Return the reward policy with the current per-flow rewards
+     * @return the reward policy
+     */
+    RewardPolicy& GetRewardPolicy()
+    {
+        return rewards;
+    }
+    /**
+     * Return the statistics collector
+     * @return the statistics collector
+     */
+    Collector& GetCollector()
+    {
+        return statisticsCollector;
+    }
+
+  private:
+    /**
+     * Exclude the statistics gathered before the end of the warmup
+     */
+    void Warmup()
+    {
+        statisticsCollector.Checkpoint();
+    }
+    /**
+     * Calculate and store the rewards of the finished round
+     */
+    void EndRound()
+    {
+        statisticsCollector.Collect(time - warmup, [this](uint32_t flow, double throughput) {
+            if (throughput > 0)
+            {
+                rewards.Update(flow, throughput);
+            }
+        });
+        rewards.EndRound();
+        output.Write(currentRound, rewards.GetRewards());
+        uint32_t finishedRound = currentRound++;
+        nodesBehaviour(finishedRound, static_cast<const RewardPolicy&>(rewards));
+    }
+
+    Collector statisticsCollector;
+    RewardPolicy rewards;
+    Writer output;
+    Behaviour nodesBehaviour;
+    uint32_t rounds;
+    double time;
+    double warmup;
+    uint32_t currentRound = 0;
+};
+
+}
+
+#endif /* MONTECARLOSIMULATORT_H */
@@ -0,0 +1,332 @@
+/*
+ * Copyright (c) 2023 AGH University of Science and Technology
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/MonteCarloJobQueue.h"
+#include "ns3/system-path.h"
+#include "ns3/test.h"
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <set>
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace ns3;
+
+/**
+ * Create an empty temporary queue directory
+ * @return path of the directory
+ */
+static std::string
+CreateQueueDirectory()
+{
+    std::string directory = SystemPath::MakeTemporaryDirectoryName();
+    SystemPath::MakeDirectories(directory);
+    return directory;
+}
+
+/**
+ * Return the number of lines of the file, 0 if it does not exist
+ * @param filename path of the file
+ * @return the number of lines
+ */
+static uint32_t
+CountLines(const std::string& filename)
+{
+    std::ifstream file(filename);
+    std::string line;
+    uint32_t lines = 0;
+    while (std::getline(file, line))
+    {
+        ++lines;
+    }
+    return lines;
+}
+
+/**
+ * Return the number of entries of the directory
+ * @param directory path of the directory
+ * @return the number of entries
+ */
+static uint32_t
+CountEntries(const std::string& directory)
+{
+    return std::distance(std::filesystem::directory_iterator(directory),
+                         std::filesystem::directory_iterator());
+}
+
+/**
+ * Every job of the campaign is claimed once and its results are moved on completion
+ */
+class MonteCarloJobQueueClaimTestCase : public TestCase
+{
+  public:
+    MonteCarloJobQueueClaimTestCase()
+        : TestCase("Claim and complete all jobs of a campaign")
+    {
+    }
+
+  private:
+    void DoRun() override
+    {
+        std::string directory = CreateQueueDirectory();
+        MonteCarloJobQueue::CreateCampaign(directory, {"--nStas=10", "--nStas=20"}, 2);
+        // An existing campaign is not overwritten
+        MonteCarloJobQueue::CreateCampaign(directory, {"--nStas=30"}, 5);
+        NS_TEST_ASSERT_MSG_EQ(CountLines(directory + "/campaign.txt"), 4u, "Wrong number of jobs");
+
+        MonteCarloJobQueue queue(directory, 3, 1, 0.1);
+        MonteCarloJobQueue::Job job;
+        std::set<std::string> claimed;
+        while (queue.Claim(job))
+        {
+            NS_TEST_ASSERT_MSG_EQ(claimed.count(job.id), 0u, "Job " << job.id << " claimed twice");
+            NS_TEST_ASSERT_MSG_EQ(job.arguments.back().rfind("--RngRun=", 0),
+                                  0u,
+                                  "Missing replication argument");
+            claimed.insert(job.id);
+            std::ofstream(job.outputName + ".csv") << job.id << std::endl;
+            queue.Complete(job);
+        }
+        NS_TEST_ASSERT_MSG_EQ(claimed.size(), 4u, "Not all jobs were claimed");
+        for (const auto& id : claimed)
+        {
+            NS_TEST_EXPECT_MSG_EQ(CountLines(directory + "/results/" + id + ".csv"),
+                                  1u,
+                                  "Missing results of job " << id);
+        }
+        NS_TEST_EXPECT_MSG_EQ(CountEntries(directory + "/claims"), 0u, "Claims were not released");
+        std::filesystem::remove_all(directory);
+    }
+};
+
+/**
+ * The claim of a dead worker is reclaimed after the stale timeout
+ */
+class MonteCarloJobQueueStaleClaimTestCase : public TestCase
+{
+  public:
+    MonteCarloJobQueueStaleClaimTestCase()
+        : TestCase("Reclaim the job of a dead worker")
+    {
+    }
+
+  private:
+    void DoRun() override
+    {
+        std::string directory = CreateQueueDirectory();
+        std::ofstream(directory + "/campaign.txt") << "job0 --nStas=1" << std::endl;
+        SystemPath::MakeDirectories(directory + "/claims");
+        SystemPath::MakeDirectories(directory + "/attempts");
+        std::ofstream(directory + "/claims/job0") << "dead.worker" << std::endl;
+        std::ofstream(directory + "/attempts/job0.dead.worker.csv") << "partial" << std::endl;
+
+        MonteCarloJobQueue queue(directory, 1.5, 0.5, 0.1);
+        MonteCarloJobQueue::Job job;
+        auto start = std::chrono::steady_clock::now();
+        NS_TEST_ASSERT_MSG_EQ(queue.Claim(job), true, "Stale job was not reclaimed");
+        double waited =
+            std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        NS_TEST_EXPECT_MSG_EQ(job.id, "job0", "Wrong job reclaimed");
+        NS_TEST_EXPECT_MSG_GT_OR_EQ(waited, 1.0, "Job reclaimed before the stale timeout");
+        std::ofstream(job.outputName + ".csv") << job.id << std::endl;
+        queue.Complete(job);
+        NS_TEST_EXPECT_MSG_EQ(queue.Claim(job), false, "Completed job claimed again");
+        NS_TEST_EXPECT_MSG_EQ(CountEntries(directory + "/attempts"),
+                              0u,
+                              "Results of the dead worker were kept");
+        NS_TEST_EXPECT_MSG_EQ(CountEntries(directory + "/results"), 1u, "Wrong results");
+        std::filesystem::remove_all(directory);
+    }
+};
+
+/**
+ * The claim of a live worker, kept by its heartbeat, is never reclaimed
+ */
+class MonteCarloJobQueueLiveClaimTestCase : public TestCase
+{
+  public:
+    MonteCarloJobQueueLiveClaimTestCase()
+        : TestCase("Keep the job of a live worker")
+    {
+    }
+
+  private:
+    void DoRun() override
+    {
+        std::string directory = CreateQueueDirectory();
+        std::ofstream(directory + "/campaign.txt") << "job0 --nStas=1" << std::endl;
+
+        MonteCarloJobQueue owner(directory, 2.5, 0.2, 0.1);
+        MonteCarloJobQueue::Job ownerJob;
+        NS_TEST_ASSERT_MSG_EQ(owner.Claim(ownerJob), true, "Job was not claimed");
+        std::thread completion([&owner, &ownerJob]() {
+            std::this_thread::sleep_for(std::chrono::duration<double>(3.5));
+            owner.Complete(ownerJob);
+        });
+
+        // Waits longer than the stale timeout until the owner completes the job
+        MonteCarloJobQueue other(directory, 2.5, 0.2, 0.1);
+        MonteCarloJobQueue::Job otherJob;
+        bool claimed = other.Claim(otherJob);
+        completion.join();
+        NS_TEST_EXPECT_MSG_EQ(claimed, false, "Live claim was reclaimed");
+        std::filesystem::remove_all(directory);
+    }
+};
+
+/**
+ * A failed job is released, retried and abandoned after maxAttempts failures
+ */
+class MonteCarloJobQueueFailTestCase : public TestCase
+{
+  public:
+    MonteCarloJobQueueFailTestCase()
+        : TestCase("Retry failed jobs up to the attempt limit")
+    {
+    }
+
+  private:
+    void DoRun() override
+    {
+        std::string directory = CreateQueueDirectory();
+        std::ofstream(directory + "/campaign.txt") << "job0 --nStas=1" << std::endl;
+
+        MonteCarloJobQueue queue(directory, 3, 1, 0.1, 2);
+        MonteCarloJobQueue::Job job;
+        for (uint32_t attempt = 0; attempt < 2; ++attempt)
+        {
+            NS_TEST_ASSERT_MSG_EQ(queue.Claim(job), true, "Failed job was not retried");
+            std::ofstream(job.outputName + ".csv") << "partial" << std::endl;
+            queue.Fail(job);
+        }
+        NS_TEST_EXPECT_MSG_EQ(queue.Claim(job), false, "Job retried beyond the attempt limit");
+        NS_TEST_EXPECT_MSG_EQ(CountEntries(directory + "/done"), 0u, "Failed job marked done");
+        NS_TEST_EXPECT_MSG_EQ(CountEntries(directory + "/results"), 0u, "Partial results kept");
+        NS_TEST_EXPECT_MSG_EQ(CountEntries(directory + "/attempts"), 0u, "Partial results kept");
+        std::filesystem::remove_all(directory);
+    }
+};
+
+/**
+ * A worker started before the campaign descriptor is created waits for it
+ */
+class MonteCarloJobQueueCampaignWaitTestCase : public TestCase
+{
+  public:
+    MonteCarloJobQueueCampaignWaitTestCase()
+        : TestCase("Wait for the campaign descriptor")
+    {
+    }
+
+  private:
+    void DoRun() override
+    {
+        std::string directory = CreateQueueDirectory();
+        MonteCarloJobQueue queue(directory, 3, 1, 0.05);
+        std::thread creation([&directory]() {
+            std::this_thread::sleep_for(std::chrono::milliseconds(200));
+            MonteCarloJobQueue::CreateCampaign(directory, {"--nStas=1"}, 1);
+        });
+        MonteCarloJobQueue::Job job;
+        bool claimed = queue.Claim(job);
+        creation.join();
+        NS_TEST_ASSERT_MSG_EQ(claimed, true, "Job of a late campaign was not claimed");
+        queue.Complete(job);
+        std::filesystem::remove_all(directory);
+    }
+};
+
+/**
+ * Concurrent worker processes run every job exactly once
+ */
+class MonteCarloJobQueueWorkersTestCase : public TestCase
+{
+  public:
+    MonteCarloJobQueueWorkersTestCase()
+        : TestCase("Share a campaign between worker processes")
+    {
+    }
+
+  private:
+    void DoRun() override
+    {
+        std::string directory = CreateQueueDirectory();
+        MonteCarloJobQueue::CreateCampaign(directory, {"--nStas=1", "--nStas=2", "--nStas=3"}, 4);
+
+        std::vector<pid_t> workers;
+        for (uint32_t worker = 0; worker < 4; ++worker)
+        {
+            pid_t child = fork();
+            NS_TEST_ASSERT_MSG_NE(child, -1, "Cannot start worker");
+            if (child == 0)
+            {
+                MonteCarloJobQueue queue(directory, 5, 1, 0.05);
+                MonteCarloJobQueue::Job job;
+                while (queue.Claim(job))
+                {
+                    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+                    std::ofstream(job.outputName + ".csv", std::ios::app) << getpid() << std::endl;
+                    queue.Complete(job);
+                }
+                _exit(0);
+            }
+            workers.push_back(child);
+        }
+        for (pid_t worker : workers)
+        {
+            int status = 0;
+            waitpid(worker, &status, 0);
+            NS_TEST_EXPECT_MSG_EQ(WIFEXITED(status) && WEXITSTATUS(status) == 0,
+                                  true,
+                                  "Worker failed");
+        }
+
+        NS_TEST_EXPECT_MSG_EQ(CountEntries(directory + "/done"), 12u, "Not all jobs completed");
+        for (const auto& entry : std::filesystem::directory_iterator(directory + "/results"))
+        {
+            NS_TEST_EXPECT_MSG_EQ(CountLines(entry.path().string()),
+                                  1u,
+                                  "Job " << entry.path() << " ran more than once");
+        }
+        NS_TEST_EXPECT_MSG_EQ(CountEntries(directory + "/results"), 12u, "Missing results");
+        NS_TEST_EXPECT_MSG_EQ(CountEntries(directory + "/claims"), 0u, "Claims were not released");
+        std::filesystem::remove_all(directory);
+    }
+};
+
+/**
+ * Test suite of the file-based job queue, run against a local temporary directory
+ */
+class MonteCarloJobQueueTestSuite : public TestSuite
+{
+  public:
+    MonteCarloJobQueueTestSuite()
+        : TestSuite("monte-carlo-job-queue", UNIT)
+    {
+        AddTestCase(new MonteCarloJobQueueClaimTestCase, TestCase::QUICK);
+        // Claims are timed with one-second resolution, so these cases take several seconds
+        AddTestCase(new MonteCarloJobQueueStaleClaimTestCase, TestCase::EXTENSIVE);
+        AddTestCase(new MonteCarloJobQueueLiveClaimTestCase, TestCase::EXTENSIVE);
+        AddTestCase(new MonteCarloJobQueueFailTestCase, TestCase::QUICK);
+        AddTestCase(new MonteCarloJobQueueCampaignWaitTestCase, TestCase::QUICK);
+        AddTestCase(new MonteCarloJobQueueWorkersTestCase, TestCase::QUICK);
+    }
+};
+
+static MonteCarloJobQueueTestSuite g_monteCarloJobQueueTestSuite; //!< Static variable for test initialization
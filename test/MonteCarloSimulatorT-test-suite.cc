@@ -0,0 +1,383 @@
+/*
+ * Copyright (c) 2023 AGH University of Science and Technology
+ *
+ * This program is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License version 2 as
+ * published by the Free Software Foundation;
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+ */
+
+#include "ns3/MonteCarloSimulator.h"
+#include "ns3/MonteCarloSimulatorT.h"
+#include "ns3/application-container.h"
+#include "ns3/packet-sink.h"
+#include "ns3/simulator.h"
+#include "ns3/system-path.h"
+#include "ns3/test.h"
+
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+
+using namespace ns3;
+
+/**
+ * Collector replaying per-round throughputs of all flows from a script; the last round of the
+ * script is repeated once it is exhausted
+ */
+class ScriptedCollector
+{
+  public:
+    /**
+     * The constructor of the collector
+     * @param roundThroughputs per-flow throughputs of consecutive rounds
+     */
+    explicit ScriptedCollector(std::vector<std::vector<double>> roundThroughputs)
+        : script(std::move(roundThroughputs))
+    {
+    }
+    uint32_t GetN() const
+    {
+        return script.front().size();
+    }
+    void Connect()
+    {
+    }
+    void Checkpoint()
+    {
+    }
+    template <typename Update>
+    void Collect(double seconds, Update&& update)
+    {
+        const std::vector<double>& throughputs = script[std::min(round, script.size() - 1)];
+        for (uint32_t flow = 0; flow < throughputs.size(); ++flow)
+        {
+            update(flow, throughputs[flow]);
+        }
+        ++round;
+    }
+
+  private:
+    std::vector<std::vector<double>> script;
+    size_t round = 0;
+};
+
+/**
+ * Three flows over three rounds; flow 1 is never active
+ */
+static const std::vector<std::vector<double>> g_script = {{2, 0, 4}, {0, 0, 8}, {6, 0, 2}};
+
+/**
+ * Run the pipeline with the given reward policy and writer over the script; the simulation is
+ * stopped at the end of the last round, as in the examples
+ * @param rewardPolicy the reward policy
+ * @param writer the output writer
+ * @param script per-flow throughputs of consecutive rounds
+ * @return the rewards of all flows after the last round
+ */
+template <typename RewardPolicy, typename Writer>
+static std::vector<double>
+RunPipeline(RewardPolicy rewardPolicy,
+            Writer writer,
+            const std::vector<std::vector<double>>& script = g_script)
+{
+    std::vector<double> rewards;
+    {
+        MonteCarloSimulatorT<ScriptedCollector, RewardPolicy, Writer> simulator(
+            ScriptedCollector(script),
+            std::move(rewardPolicy),
+            std::move(writer),
+            script.size() - 1,
+            2,
+            1);
+        Simulator::Stop(Seconds(script.size() * 2));
+        Simulator::Run();
+        rewards = simulator.GetRewardPolicy().GetRewards();
+    }
+    Simulator::Destroy();
+    return rewards;
+}
+
+/**
+ * Return the number of lines of the file, 0 if it does not exist
+ * @param filename path of the file
+ * @return the number of lines
+ */
+static uint32_t
+CountLines(const std::string& filename)
+{
+    std::ifstream file(filename);
+    std::string line;
+    uint32_t lines = 0;
+    while (std::getline(file, line))
+    {
+        ++lines;
+    }
+    return lines;
+}
+
+/**
+ * The running mean reward averages active rounds and the .csv writer stores every round
+ */
+class MonteCarloSimulatorTRunningMeanTestCase : public TestCase
+{
+  public:
+    MonteCarloSimulatorTRunningMeanTestCase()
+        : TestCase("Running mean reward written to a .csv file")
+    {
+    }
+
+  private:
+    void DoRun() override
+    {
+        std::string directory = SystemPath::MakeTemporaryDirectoryName();
+        SystemPath::MakeDirectories(directory);
+        std::vector<double> rewards =
+            RunPipeline(RunningMeanReward(), CsvRewardWriter(directory + "/mean"));
+        NS_TEST_EXPECT_MSG_EQ_TOL(rewards[0], 4.0, 1e-9, "Wrong reward of flow 0");
+        NS_TEST_EXPECT_MSG_EQ(rewards[1], 0.0, "Inactive flow has a reward");
+        NS_TEST_EXPECT_MSG_EQ_TOL(rewards[2], 14.0 / 3, 1e-9, "Wrong reward of flow 2");
+        NS_TEST_EXPECT_MSG_EQ(CountLines(directory + "/mean.csv"),
+                              4u,
+                              "Expected the header and three rounds");
+        std::filesystem::remove_all(directory);
+    }
+};
+
+/**
+ * The EWMA reward starts at the first active throughput and idle rounds keep the reward
+ */
+class MonteCarloSimulatorTEwmaTestCase : public TestCase
+{
+  public:
+    MonteCarloSimulatorTEwmaTestCase()
+        : TestCase("EWMA reward")
+    {
+    }
+
+  private:
+    void DoRun() override
+    {
+        std::vector<double> rewards = RunPipeline(EwmaReward(0.5), NullRewardWriter());
+        NS_TEST_EXPECT_MSG_EQ_TOL(rewards[0], 4.0, 1e-9, "Wrong reward of flow 0");
+        NS_TEST_EXPECT_MSG_EQ(rewards[1], 0.0, "Inactive flow has a reward");
+        NS_TEST_EXPECT_MSG_EQ_TOL(rewards[2], 4.0, 1e-9, "Wrong reward of flow 2");
+    }
+};
+
+/**
+ * The sliding window reward averages the last active rounds only
+ */
+class MonteCarloSimulatorTSlidingWindowTestCase : public TestCase
+{
+  public:
+    MonteCarloSimulatorTSlidingWindowTestCase()
+        : TestCase("Sliding window reward")
+    {
+    }
+
+  private:
+    void DoRun() override
+    {
+        std::vector<double> rewards = RunPipeline(SlidingWindowReward(2), NullRewardWriter());
+        NS_TEST_EXPECT_MSG_EQ_TOL(rewards[0], 4.0, 1e-9, "Wrong reward of flow 0");
+        NS_TEST_EXPECT_MSG_EQ(rewards[1], 0.0, "Inactive flow has a reward");
+        NS_TEST_EXPECT_MSG_EQ_TOL(rewards[2], 5.0, 1e-9, "Wrong reward of flow 2");
+    }
+};
+
+/**
+ * The max-min fairness reward averages the lowest active throughput of each round
+ */
+class MonteCarloSimulatorTMaxMinTestCase : public TestCase
+{
+  public:
+    MonteCarloSimulatorTMaxMinTestCase()
+        : TestCase("Max-min fairness reward")
+    {
+    }
+
+  private:
+    void DoRun() override
+    {
+        std::vector<double> rewards = RunPipeline(MaxMinFairnessReward(), NullRewardWriter());
+        NS_TEST_EXPECT_MSG_EQ_TOL(rewards[0], 2.0, 1e-9, "Wrong reward of flow 0");
+        NS_TEST_EXPECT_MSG_EQ(rewards[1], 0.0, "Inactive flow has a reward");
+        NS_TEST_EXPECT_MSG_EQ_TOL(rewards[2], 4.0, 1e-9, "Wrong reward of flow 2");
+    }
+};
+
+/**
+ * The proportional fairness reward is non-negative, does not depend on the number of active
+ * flows and keeps untried flows at the lowest reward
+ */
+class MonteCarloSimulatorTProportionalFairnessTestCase : public TestCase
+{
+  public:
+    MonteCarloSimulatorTProportionalFairnessTestCase()
+        : TestCase("Proportional fairness reward")
+    {
+    }
+
+  private:
+    void DoRun() override
+    {
+        std::vector<double> rewards =
+            RunPipeline(ProportionalFairnessReward(), NullRewardWriter());
+        double firstRound = (std::log1p(2.0) + std::log1p(4.0)) / 2;
+        double lastRound = (std::log1p(6.0) + std::log1p(2.0)) / 2;
+        NS_TEST_EXPECT_MSG_EQ_TOL(rewards[0],
+                                  (firstRound + lastRound) / 2,
+                                  1e-9,
+                                  "Wrong reward of flow 0");
+        NS_TEST_EXPECT_MSG_EQ(rewards[1], 0.0, "Inactive flow has a reward");
+        NS_TEST_EXPECT_MSG_EQ_TOL(rewards[2],
+                                  (firstRound + std::log1p(8.0) + lastRound) / 3,
+                                  1e-9,
+                                  "Wrong reward of flow 2");
+
+        // Flows below 1 Mb/s must not be rewarded below untried flows
+        rewards = RunPipeline(ProportionalFairnessReward(), NullRewardWriter(), {{0.5, 0}});
+        NS_TEST_EXPECT_MSG_GT(rewards[0], rewards[1], "Active flow rewarded below idle flow");
+
+        // Equal throughputs give the same utility regardless of the number of active flows
+        std::vector<double> single =
+            RunPipeline(ProportionalFairnessReward(), NullRewardWriter(), {{3, 0, 0}});
+        std::vector<double> shared =
+            RunPipeline(ProportionalFairnessReward(), NullRewardWriter(), {{3, 3, 3}});
+        NS_TEST_EXPECT_MSG_EQ_TOL(single[0], shared[0], 1e-9, "Utility depends on flow count");
+    }
+};
+
+/**
+ * MonteCarloSimulator with custom hooks invokes the behaviour before the reward function, writes
+ * the rewards of the reward function in each round and stops at the end condition
+ */
+class MonteCarloSimulatorCustomRewardTestCase : public TestCase
+{
+  public:
+    MonteCarloSimulatorCustomRewardTestCase()
+        : TestCase("MonteCarloSimulator with custom reward calculation")
+    {
+    }
+
+  private:
+    void DoRun() override
+    {
+        std::string directory = SystemPath::MakeTemporaryDirectoryName();
+        SystemPath::MakeDirectories(directory);
+        ApplicationContainer sinkApplications;
+        sinkApplications.Add(CreateObject<PacketSink>());
+        sinkApplications.Add(CreateObject<PacketSink>());
+        std::vector<int> behaviourRounds;
+        uint32_t warmupCalls = 0;
+        {
+            int* round = nullptr;
+            MonteCarloSimulator monteCarloSimulator = MonteCarloSimulator(
+                &sinkApplications, 4, 2, 1, directory + "/custom",
+                MonteCarloSimulator::MAX_ROUNDS, false,
+                [&behaviourRounds, &round]() { behaviourRounds.push_back(*round); });
+            round = monteCarloSimulator.GetCurrentRound();
+            double(*rewardArray)[MonteCarloSimulator::MAX_ROUNDS] =
+                monteCarloSimulator.GetRewardArray();
+            monteCarloSimulator.SetRewardCalculationFunction([round, rewardArray]() {
+                rewardArray[0][*round] = *round;
+                rewardArray[1][*round] = 10 * *round;
+            });
+            monteCarloSimulator.SetWarmupStatisticsCollectionFunction(
+                [&warmupCalls]() { ++warmupCalls; });
+            monteCarloSimulator.SetEndConditionFunction([round]() { return *round >= 2; });
+            Simulator::Run();
+
+            NS_TEST_EXPECT_MSG_EQ(*round, 2, "The end condition did not stop the simulation");
+            NS_TEST_EXPECT_MSG_EQ(rewardArray[1][1], 10.0, "Wrong custom reward");
+        }
+        Simulator::Destroy();
+        NS_TEST_ASSERT_MSG_EQ(behaviourRounds.size(),
+                              2u,
+                              "Behaviour not invoked after each round");
+        NS_TEST_EXPECT_MSG_EQ(behaviourRounds[0],
+                              0,
+                              "Behaviour must precede the reward calculation");
+        NS_TEST_EXPECT_MSG_EQ(behaviourRounds[1],
+                              1,
+                              "Behaviour must precede the reward calculation");
+        NS_TEST_EXPECT_MSG_EQ(warmupCalls, 2u, "Warmup function not invoked in each round");
+        NS_TEST_EXPECT_MSG_EQ(CountLines(directory + "/custom.csv"),
+                              3u,
+                              "Expected the header and two rounds");
+        std::filesystem::remove_all(directory);
+    }
+};
+
+/**
+ * The last round ends before Simulator::Stop() scheduled for the same time, so that rounds 0 to
+ * numberOfRounds are written
+ */
+class MonteCarloSimulatorStopTestCase : public TestCase
+{
+  public:
+    MonteCarloSimulatorStopTestCase()
+        : TestCase("MonteCarloSimulator writes the last round before the simulation stops")
+    {
+    }
+
+  private:
+    void DoRun() override
+    {
+        std::string directory = SystemPath::MakeTemporaryDirectoryName();
+        SystemPath::MakeDirectories(directory);
+        ApplicationContainer sinkApplications;
+        sinkApplications.Add(CreateObject<PacketSink>());
+        sinkApplications.Add(CreateObject<PacketSink>());
+        double numberOfRounds = 3;
+        double roundTime = 2;
+        uint32_t behaviourCalls = 0;
+        {
+            MonteCarloSimulator monteCarloSimulator = MonteCarloSimulator(
+                &sinkApplications, numberOfRounds, roundTime, 1, directory + "/stop",
+                MonteCarloSimulator::MAX_ROUNDS, true,
+                [&behaviourCalls]() { ++behaviourCalls; });
+            Simulator::Stop(Seconds((numberOfRounds + 1) * roundTime));
+            Simulator::Run();
+            NS_TEST_EXPECT_MSG_EQ(*monteCarloSimulator.GetCurrentRound(),
+                                  numberOfRounds + 1,
+                                  "The last round was not finished");
+        }
+        Simulator::Destroy();
+        NS_TEST_EXPECT_MSG_EQ(behaviourCalls, 4u, "Behaviour not invoked after each round");
+        NS_TEST_EXPECT_MSG_EQ(CountLines(directory + "/stop.csv"),
+                              5u,
+                              "Expected the header and rounds 0 to numberOfRounds");
+        std::filesystem::remove_all(directory);
+    }
+};
+
+/**
+ * Test suite of the compile-time simulator pipeline and of MonteCarloSimulator built on it
+ */
+class MonteCarloSimulatorTTestSuite : public TestSuite
+{
+  public:
+    MonteCarloSimulatorTTestSuite()
+        : TestSuite("monte-carlo-simulator-t", UNIT)
+    {
+        AddTestCase(new MonteCarloSimulatorTRunningMeanTestCase, TestCase::QUICK);
+        AddTestCase(new MonteCarloSimulatorTEwmaTestCase, TestCase::QUICK);
+        AddTestCase(new MonteCarloSimulatorTSlidingWindowTestCase, TestCase::QUICK);
+        AddTestCase(new MonteCarloSimulatorTMaxMinTestCase, TestCase::QUICK);
+        AddTestCase(new MonteCarloSimulatorTProportionalFairnessTestCase, TestCase::QUICK);
+        AddTestCase(new MonteCarloSimulatorCustomRewardTestCase, TestCase::QUICK);
+        AddTestCase(new MonteCarloSimulatorStopTestCase, TestCase::QUICK);
+    }
+};
+
+static MonteCarloSimulatorTTestSuite g_monteCarloSimulatorTTestSuite; //!< Static variable for test initialization